@@ -0,0 +1,1031 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "BulkIO.hpp"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Debug.hpp"
+#include "MappedFile.hpp"
+
+// Exports are formatted into a buffer this big before it's handed to the file
+#define BULK_WRITE_BUFFER (1024 * 1024)
+
+// Values we don't care about get skipped, however deep they go. Past this it's not a dictionary.
+#define JSON_MAX_DEPTH 64
+
+#define UTF8_BOM "\xEF\xBB\xBF"
+
+// A range of ParsedChunk::text, or of the scratch buffer a row is read into
+struct Span
+{
+  size_t offset = 0;
+  size_t length = 0;
+};
+
+struct ParsedRow
+{
+  Span key;
+  Span expansion;
+  uint8_t flags;
+  uint8_t known; // flag bits the row spelled out, the rest are kept from an existing entry
+};
+
+// Everything a worker makes of one chunk, merged into the dictionary by the thread that started the
+// import once every chunk before it is in
+struct ParsedChunk
+{
+  std::string text; // the keys and expansions, unescaped
+  std::vector<ParsedRow> rows;
+  size_t skipped  = 0;
+  size_t failedAt = SIZE_MAX; // offset into the file where a JSON chunk stopped making sense
+  bool closed     = false;    // a JSON chunk got to the ] at the end of the array
+};
+
+// Which field of a CSV or TSV row holds what, -1 for a column the file doesn't have
+struct Columns
+{
+  int key       = 0;
+  int expansion = 1;
+  int multiline = 2;
+  int hidden    = 3;
+  int paste     = 4;
+};
+
+static bool sameText(std::string_view text, const char *name)
+{
+  size_t length = strlen(name);
+  if (text.size() != length) { return false; }
+  for (size_t i = 0; i < length; i++)
+  {
+    if (tolower((unsigned char)text[i]) != name[i]) { return false; }
+  }
+  return true;
+}
+
+static std::string_view trim(std::string_view text)
+{
+  while (!text.empty() && isspace((unsigned char)text.front())) { text.remove_prefix(1); }
+  while (!text.empty() && isspace((unsigned char)text.back())) { text.remove_suffix(1); }
+  return text;
+}
+
+// What spreadsheets and scripts tend to write for a ticked box
+static bool truthy(std::string_view value)
+{
+  value = trim(value);
+  return sameText(value, "1") || sameText(value, "true") || sameText(value, "yes") || sameText(value, "y") ||
+         sameText(value, "x");
+}
+
+static size_t lineOf(const char *data, size_t offset)
+{
+  return 1 + (size_t)std::count(data, data + offset, '\n');
+}
+
+BulkFormat BulkIO::formatOf(const char *path)
+{
+  const char *dot = strrchr(path, '.');
+  if (dot == nullptr) { return BULK_UNKNOWN; }
+  std::string_view extension(dot + 1);
+  if (sameText(extension, "csv")) { return BULK_CSV; }
+  if (sameText(extension, "tsv") || sameText(extension, "tab")) { return BULK_TSV; }
+  if (sameText(extension, "json")) { return BULK_JSON; }
+  return BULK_UNKNOWN;
+}
+
+bool BulkIO::parseFormat(const char *name, BulkFormat *format)
+{
+  for (BulkFormat candidate : {BULK_CSV, BULK_TSV, BULK_JSON})
+  {
+    if (sameText(name, formatName(candidate)))
+    {
+      *format = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *BulkIO::formatName(BulkFormat format)
+{
+  switch (format)
+  {
+  case BULK_CSV: return "csv";
+  case BULK_TSV: return "tsv";
+  case BULK_JSON: return "json";
+  default: return "unknown";
+  }
+}
+
+// Reads one CSV row starting at `p` into fields, as ranges of scratch. Returns where the next row
+// starts. A quote that never closes takes the rest of the chunk with it.
+static const char *readCsvRow(const char *p, const char *end, std::string &scratch, std::vector<Span> &fields)
+{
+  scratch.clear();
+  fields.clear();
+  while (true)
+  {
+    size_t start = scratch.size();
+    if (p < end && *p == '"')
+    {
+      p++;
+      while (true)
+      {
+        const char *quote = (const char *)memchr(p, '"', end - p);
+        if (quote == nullptr)
+        {
+          scratch.append(p, end - p);
+          p = end;
+          break;
+        }
+        scratch.append(p, quote - p);
+        p = quote + 1;
+        if (p == end || *p != '"') { break; }
+        scratch.push_back('"');
+        p++;
+      }
+    }
+
+    // unquoted, or whatever follows the closing quote, which spreadsheets keep as it is
+    const char *run = p;
+    while (p < end && *p != ',' && *p != '\n' && *p != '\r') { p++; }
+    scratch.append(run, p - run);
+    fields.push_back({start, scratch.size() - start});
+
+    if (p < end && *p == ',')
+    {
+      p++;
+      continue;
+    }
+    if (p < end && *p == '\r') { p++; }
+    if (p < end && *p == '\n') { p++; }
+    return p;
+  }
+}
+
+// Same for TSV, where fields can't hold a raw tab or line break and escape them instead
+static const char *readTsvRow(const char *p, const char *end, std::string &scratch, std::vector<Span> &fields)
+{
+  scratch.clear();
+  fields.clear();
+  size_t start = 0;
+  while (true)
+  {
+    const char *run = p;
+    while (p < end && *p != '\t' && *p != '\n' && *p != '\r' && *p != '\\') { p++; }
+    scratch.append(run, p - run);
+
+    if (p < end && *p == '\\')
+    {
+      // a backslash before anything we don't escape is kept as it is
+      char unescaped = 0;
+      if (++p < end)
+      {
+        if (*p == 't') { unescaped = '\t'; }
+        else if (*p == 'n') { unescaped = '\n'; }
+        else if (*p == 'r') { unescaped = '\r'; }
+        else if (*p == '\\') { unescaped = '\\'; }
+      }
+      if (unescaped != 0) { p++; }
+      scratch.push_back(unescaped != 0 ? unescaped : '\\');
+      continue;
+    }
+
+    fields.push_back({start, scratch.size() - start});
+    start = scratch.size();
+    if (p < end && *p == '\t')
+    {
+      p++;
+      continue;
+    }
+    if (p < end && *p == '\r') { p++; }
+    if (p < end && *p == '\n') { p++; }
+    return p;
+  }
+}
+
+static uint8_t flagsOf(bool multiline, bool hidden, bool paste)
+{
+  return (multiline ? ENTRY_MULTILINE : 0) | (hidden ? ENTRY_HIDDEN : 0) | (paste ? ENTRY_PASTE : 0);
+}
+
+static Span copyInto(std::string &text, const char *bytes, size_t length)
+{
+  Span span = {text.size(), length};
+  text.append(bytes, length);
+  return span;
+}
+
+static void addRow(const std::string &scratch, const std::vector<Span> &fields, const Columns &columns,
+                   ParsedChunk *chunk)
+{
+  if (fields.size() == 1 && fields[0].length == 0) { return; } // blank line
+
+  int count = (int)fields.size();
+  if (columns.key >= count || columns.expansion >= count || fields[columns.key].length == 0)
+  {
+    chunk->skipped++;
+    return;
+  }
+
+  const Span &key       = fields[columns.key];
+  const Span &expansion = fields[columns.expansion];
+  const char *text      = scratch.data();
+
+  bool multiline = memchr(text + expansion.offset, '\n', expansion.length) != nullptr;
+  bool hidden    = false;
+  bool paste     = false;
+  uint8_t known  = ENTRY_MULTILINE; // worked out from the expansion when there's no column for it
+  if (columns.multiline >= 0 && columns.multiline < count)
+  {
+    const Span &field = fields[columns.multiline];
+    multiline         = truthy(std::string_view(text + field.offset, field.length));
+  }
+  if (columns.hidden >= 0 && columns.hidden < count)
+  {
+    const Span &field = fields[columns.hidden];
+    hidden            = truthy(std::string_view(text + field.offset, field.length));
+    known |= ENTRY_HIDDEN;
+  }
+  if (columns.paste >= 0 && columns.paste < count)
+  {
+    const Span &field = fields[columns.paste];
+    paste             = truthy(std::string_view(text + field.offset, field.length));
+    known |= ENTRY_PASTE;
+  }
+
+  ParsedRow row;
+  row.key       = copyInto(chunk->text, text + key.offset, key.length);
+  row.expansion = copyInto(chunk->text, text + expansion.offset, expansion.length);
+  row.flags     = flagsOf(multiline, hidden, paste);
+  row.known     = known;
+  chunk->rows.push_back(row);
+}
+
+// A first row that names both the abbreviation and the expansion column is a header, and decides
+// where every other column is. Returns where the rows after it start.
+static size_t readHeader(BulkFormat format, const char *data, size_t begin, size_t size, Columns *columns)
+{
+  std::string scratch;
+  std::vector<Span> fields;
+  const char *next = format == BULK_CSV ? readCsvRow(data + begin, data + size, scratch, fields)
+                                        : readTsvRow(data + begin, data + size, scratch, fields);
+
+  Columns named = {-1, -1, -1, -1, -1};
+  for (int i = 0; i < fields.size(); i++)
+  {
+    std::string_view name = trim(std::string_view(scratch.data() + fields[i].offset, fields[i].length));
+    if (sameText(name, "abbreviation") || sameText(name, "key")) { named.key = i; }
+    else if (sameText(name, "expansion") || sameText(name, "expands to")) { named.expansion = i; }
+    else if (sameText(name, "multiline") || sameText(name, "multi-line")) { named.multiline = i; }
+    else if (sameText(name, "hidden")) { named.hidden = i; }
+    else if (sameText(name, "paste")) { named.paste = i; }
+  }
+  if (named.key == -1 || named.expansion == -1) { return begin; }
+
+  *columns = named;
+  return next - data;
+}
+
+// Reads JSON text in place. Only as much of JSON as an array of flat objects needs is
+// interpreted, anything else is checked for shape and skipped.
+class JsonReader
+{
+public:
+  JsonReader(const char *p, const char *end) : p(p), end(end) {}
+
+  void skipWhitespace()
+  {
+    while (p < end && isspace((unsigned char)*p)) { p++; }
+  }
+
+  bool at(char c) const { return p < end && *p == c; }
+
+  // Appends the string at p to out, unescaped
+  bool string(std::string &out)
+  {
+    if (!at('"')) { return false; }
+    p++;
+    while (true)
+    {
+      const char *run = p;
+      while (p < end && *p != '"' && *p != '\\') { p++; }
+      out.append(run, p - run);
+      if (p == end) { return false; }
+      if (*p++ == '"') { return true; }
+      if (p == end) { return false; }
+
+      char escaped = *p++;
+      switch (escaped)
+      {
+      case '"': out.push_back('"'); break;
+      case '\\': out.push_back('\\'); break;
+      case '/': out.push_back('/'); break;
+      case 'b': out.push_back('\b'); break;
+      case 'f': out.push_back('\f'); break;
+      case 'n': out.push_back('\n'); break;
+      case 'r': out.push_back('\r'); break;
+      case 't': out.push_back('\t'); break;
+      case 'u':
+        if (!codePoint(out)) { return false; }
+        break;
+      default: return false;
+      }
+    }
+  }
+
+  // true, false, null or a number, as the text it's written as
+  bool literal(std::string_view *token)
+  {
+    const char *start = p;
+    while (p < end && (isalnum((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.')) { p++; }
+    *token = std::string_view(start, p - start);
+    return p > start;
+  }
+
+  bool boolean(bool *value)
+  {
+    std::string_view token;
+    if (at('"'))
+    {
+      scratch.clear();
+      if (!string(scratch)) { return false; }
+      token = scratch;
+    }
+    else if (!literal(&token)) { return false; }
+    *value = truthy(token);
+    return true;
+  }
+
+  bool skipValue(int depth = 0)
+  {
+    if (depth > JSON_MAX_DEPTH) { return false; }
+    if (at('"'))
+    {
+      scratch.clear();
+      return string(scratch);
+    }
+    if (!at('{') && !at('['))
+    {
+      std::string_view token;
+      return literal(&token);
+    }
+
+    bool object = *p++ == '{';
+    char close  = object ? '}' : ']';
+    skipWhitespace();
+    if (at(close))
+    {
+      p++;
+      return true;
+    }
+    while (true)
+    {
+      skipWhitespace();
+      if (object)
+      {
+        scratch.clear();
+        if (!string(scratch)) { return false; }
+        skipWhitespace();
+        if (!at(':')) { return false; }
+        p++;
+        skipWhitespace();
+      }
+      if (!skipValue(depth + 1)) { return false; }
+      skipWhitespace();
+      if (at(close))
+      {
+        p++;
+        return true;
+      }
+      if (!at(',')) { return false; }
+      p++;
+    }
+  }
+
+  const char *p;
+  const char *end;
+
+private:
+  static int hex(char c)
+  {
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+  }
+
+  bool hex4(uint32_t *value)
+  {
+    if (end - p < 4) { return false; }
+    *value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      int digit = hex(*p++);
+      if (digit < 0) { return false; }
+      *value = *value << 4 | digit;
+    }
+    return true;
+  }
+
+  // The \u escape p is just past the u of, written out as UTF-8. A surrogate without its other
+  // half becomes U+FFFD.
+  bool codePoint(std::string &out)
+  {
+    uint32_t code;
+    if (!hex4(&code)) { return false; }
+    if (code >= 0xD800 && code <= 0xDBFF)
+    {
+      uint32_t low;
+      if (end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+      {
+        p += 2;
+        if (!hex4(&low)) { return false; }
+        code = low >= 0xDC00 && low <= 0xDFFF ? 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00) : 0xFFFD;
+      }
+      else { code = 0xFFFD; }
+    }
+    else if (code >= 0xDC00 && code <= 0xDFFF) { code = 0xFFFD; }
+
+    if (code < 0x80) { out.push_back((char)code); }
+    else if (code < 0x800)
+    {
+      out.push_back((char)(0xC0 | code >> 6));
+      out.push_back((char)(0x80 | (code & 0x3F)));
+    }
+    else if (code < 0x10000)
+    {
+      out.push_back((char)(0xE0 | code >> 12));
+      out.push_back((char)(0x80 | (code >> 6 & 0x3F)));
+      out.push_back((char)(0x80 | (code & 0x3F)));
+    }
+    else
+    {
+      out.push_back((char)(0xF0 | code >> 18));
+      out.push_back((char)(0x80 | (code >> 12 & 0x3F)));
+      out.push_back((char)(0x80 | (code >> 6 & 0x3F)));
+      out.push_back((char)(0x80 | (code & 0x3F)));
+    }
+    return true;
+  }
+
+  std::string scratch; // strings nobody asked for
+};
+
+// One {...} of the array. Members other than the four we know about are skipped.
+static bool readJsonObject(JsonReader &in, ParsedChunk *chunk)
+{
+  if (!in.at('{')) { return false; }
+  in.p++;
+
+  std::string &text = chunk->text;
+  size_t start      = text.size();
+  std::string name;
+  Span key;
+  Span expansion;
+  bool hasExpansion = false;
+  bool multiline    = false;
+  bool hasMultiline = false;
+  bool hidden       = false;
+  bool paste        = false;
+  uint8_t known     = ENTRY_MULTILINE;
+
+  in.skipWhitespace();
+  if (in.at('}')) { in.p++; }
+  else
+  {
+    while (true)
+    {
+      in.skipWhitespace();
+      name.clear();
+      if (!in.string(name)) { return false; }
+      in.skipWhitespace();
+      if (!in.at(':')) { return false; }
+      in.p++;
+      in.skipWhitespace();
+
+      bool isKey       = name == "abbreviation" || name == "key";
+      bool isExpansion = name == "expansion" || name == "expandsTo";
+      if ((isKey || isExpansion) && in.at('"'))
+      {
+        Span &span  = isKey ? key : expansion;
+        span.offset = text.size();
+        if (!in.string(text)) { return false; }
+        span.length = text.size() - span.offset;
+        if (isExpansion) { hasExpansion = true; }
+      }
+      else if (name == "multiline" || name == "isMultiline")
+      {
+        if (!in.boolean(&multiline)) { return false; }
+        hasMultiline = true;
+      }
+      else if (name == "hidden" || name == "isHidden")
+      {
+        if (!in.boolean(&hidden)) { return false; }
+        known |= ENTRY_HIDDEN;
+      }
+      else if (name == "paste")
+      {
+        if (!in.boolean(&paste)) { return false; }
+        known |= ENTRY_PASTE;
+      }
+      else if (!in.skipValue()) { return false; }
+
+      in.skipWhitespace();
+      if (in.at('}'))
+      {
+        in.p++;
+        break;
+      }
+      if (!in.at(',')) { return false; }
+      in.p++;
+    }
+  }
+
+  if (key.length == 0 || !hasExpansion)
+  {
+    text.resize(start);
+    chunk->skipped++;
+    return true;
+  }
+  if (!hasMultiline) { multiline = memchr(text.data() + expansion.offset, '\n', expansion.length) != nullptr; }
+  chunk->rows.push_back({key, expansion, flagsOf(multiline, hidden, paste), known});
+  return true;
+}
+
+// Chunks of a JSON import split the array between two objects, so each one is a run of objects
+// with commas between them. The first starts right after the [, the last ends with the ].
+static void readJsonChunk(const char *data, size_t begin, size_t end, bool first, ParsedChunk *chunk)
+{
+  JsonReader in(data + begin, data + end);
+  bool needsComma = !first;
+  while (true)
+  {
+    in.skipWhitespace();
+    if (in.p == in.end) { return; }
+    if (in.at(']'))
+    {
+      in.p++;
+      in.skipWhitespace();
+      if (in.p != in.end) { break; }
+      chunk->closed = true;
+      return;
+    }
+    if (needsComma)
+    {
+      if (!in.at(',')) { break; }
+      in.p++;
+      in.skipWhitespace();
+    }
+    if (!readJsonObject(in, chunk)) { break; }
+    needsComma = true;
+  }
+  chunk->failedAt = in.p - data;
+}
+
+static void readChunk(BulkFormat format, const char *data, size_t begin, size_t end, bool first,
+                      const Columns &columns, ParsedChunk *chunk)
+{
+  if (format == BULK_JSON)
+  {
+    readJsonChunk(data, begin, end, first, chunk);
+    return;
+  }
+
+  std::string scratch;
+  std::vector<Span> fields;
+  const char *p    = data + begin;
+  const char *stop = data + end;
+  while (p < stop)
+  {
+    p = format == BULK_CSV ? readCsvRow(p, stop, scratch, fields) : readTsvRow(p, stop, scratch, fields);
+    addRow(scratch, fields, columns, chunk);
+  }
+}
+
+// Where each chunk starts, the first row boundary at or after every BULK_CHUNK_BYTES, with the end of
+// the file last. A TSV row can't span lines, so any line break will do. CSV and JSON can both have
+// line breaks inside quotes, which means following the quoting from the start; that's a single
+// pass over bytes and much cheaper than parsing them. JSON chunks end after an object in the array.
+static std::vector<size_t> chunkBoundaries(BulkFormat format, const char *data, size_t begin, size_t size)
+{
+  std::vector<size_t> bounds = {begin};
+  size_t target              = begin + BULK_CHUNK_BYTES;
+  if (format == BULK_TSV)
+  {
+    while (target < size)
+    {
+      const char *newline = (const char *)memchr(data + target - 1, '\n', size - target + 1);
+      if (newline == nullptr) { break; }
+      bounds.push_back(newline - data + 1);
+      target = bounds.back() + BULK_CHUNK_BYTES;
+    }
+  }
+  else if (format == BULK_CSV)
+  {
+    bool quoted = false;
+    for (size_t i = begin; i < size; i++)
+    {
+      if (data[i] == '"') { quoted = !quoted; }
+      else if (data[i] == '\n' && !quoted && i + 1 >= target)
+      {
+        bounds.push_back(i + 1);
+        target = i + 1 + BULK_CHUNK_BYTES;
+      }
+    }
+  }
+  else
+  {
+    bool inString = false;
+    bool escaped  = false;
+    int depth     = 1; // inside the array
+    for (size_t i = begin; i < size; i++)
+    {
+      char c = data[i];
+      if (inString)
+      {
+        if (escaped) { escaped = false; }
+        else if (c == '\\') { escaped = true; }
+        else if (c == '"') { inString = false; }
+      }
+      else if (c == '"') { inString = true; }
+      else if (c == '{' || c == '[') { depth++; }
+      else if (c == '}' || c == ']')
+      {
+        depth--;
+        if (c == '}' && depth == 1 && i + 1 >= target)
+        {
+          bounds.push_back(i + 1);
+          target = i + 1 + BULK_CHUNK_BYTES;
+        }
+      }
+    }
+  }
+
+  if (bounds.back() < size) { bounds.push_back(size); }
+  return bounds;
+}
+
+// Folds parsed rows into entries in file order. rowOfKey finds the row a key fires today, `set`
+// which rows this import already wrote.
+struct Merge
+{
+  EntryTable *entries;
+  BulkStats *stats;
+  std::unordered_map<std::string, int> rowOfKey;
+  std::vector<uint8_t> set;
+
+  Merge(EntryTable *entries, BulkStats *stats) : entries(entries), stats(stats) {}
+
+  void index()
+  {
+    rowOfKey.reserve(entries->size());
+    for (int row = 0; row < entries->size(); row++)
+    {
+      // later rows win, same as the matcher
+      rowOfKey[std::string(entries->key(row), entries->keys[row].length)] = row;
+    }
+    set.assign(entries->size(), 0);
+  }
+
+  void add(const ParsedChunk &chunk)
+  {
+    for (const ParsedRow &parsed : chunk.rows)
+    {
+      const char *key       = chunk.text.data() + parsed.key.offset;
+      const char *expansion = chunk.text.data() + parsed.expansion.offset;
+      size_t length         = parsed.expansion.length;
+      stats->rows++;
+
+      auto found = rowOfKey.try_emplace(std::string(key, parsed.key.length), -1);
+      if (found.second)
+      {
+        found.first->second = entries->add(-1, key, parsed.key.length, expansion, length, parsed.flags);
+        set.push_back(1);
+        stats->added++;
+        continue;
+      }
+
+      int row       = found.first->second;
+      bool same = entries->expansions[row].length == length && memcmp(entries->expansion(row), expansion, length) == 0;
+      uint8_t flags = (entries->flags[row] & ~parsed.known) | parsed.flags;
+      if (set[row]) { stats->duplicates++; }
+      else if (same && entries->flags[row] == flags) { stats->unchanged++; }
+      else { stats->updated++; }
+      set[row] = 1;
+
+      // left alone when it's the same, so a lazily loaded expansion stays on disk
+      if (!same) { entries->setExpansion(row, expansion, length); }
+      entries->flags[row] = flags;
+    }
+    stats->skipped += chunk.skipped;
+  }
+};
+
+bool BulkIO::read(const char *path, BulkFormat format, EntryTable *entries, BulkStats *stats)
+{
+  using Clock             = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  *stats                  = BulkStats();
+  if (format == BULK_UNKNOWN)
+  {
+    ERR("Don't know what format %s is in", path);
+    return false;
+  }
+
+  MappedFile file;
+  if (!file.open(path))
+  {
+    ERR("Failed to open %s", path);
+    return false;
+  }
+  const char *data = file.data;
+  size_t begin     = file.size >= 3 && memcmp(data, UTF8_BOM, 3) == 0 ? 3 : 0;
+
+  Columns columns;
+  if (format == BULK_JSON)
+  {
+    while (begin < file.size && isspace((unsigned char)data[begin])) { begin++; }
+    if (begin == file.size || data[begin] != '[')
+    {
+      stats->errorLine = lineOf(data, begin);
+      ERR("%s isn't a JSON array", path);
+      return false;
+    }
+    begin++;
+  }
+  else { begin = readHeader(format, data, begin, file.size, &columns); }
+
+  std::vector<size_t> bounds = chunkBoundaries(format, data, begin, file.size);
+  size_t count               = bounds.size() - 1;
+
+  std::vector<std::unique_ptr<ParsedChunk>> parsed(count);
+  std::mutex mutex;
+  std::condition_variable parsedOne;
+  std::condition_variable mergedOne;
+  size_t nextChunk    = 0;
+  size_t mergedChunks = 0;
+  bool stopping       = false;
+
+  size_t workerCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+  size_t ahead       = workerCount * BULK_CHUNKS_AHEAD;
+  auto work          = [&]()
+  {
+    while (true)
+    {
+      size_t index;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        mergedOne.wait(lock, [&] { return stopping || nextChunk >= count || nextChunk < mergedChunks + ahead; });
+        if (stopping || nextChunk >= count) { return; }
+        index = nextChunk++;
+      }
+
+      std::unique_ptr<ParsedChunk> chunk(new ParsedChunk());
+      readChunk(format, data, bounds[index], bounds[index + 1], index == 0, columns, chunk.get());
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        parsed[index] = std::move(chunk);
+      }
+      parsedOne.notify_all();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < workerCount; i++)
+  {
+    workers.emplace_back(work);
+  }
+
+  // Merged into a copy, so a file that turns out to be broken halfway leaves entries as they were.
+  // Indexing it overlaps with the workers getting started on the first chunks.
+  EntryTable merged = *entries;
+  Merge merge(&merged, stats);
+  merge.index();
+
+  bool closed = format != BULK_JSON;
+  bool failed = false;
+  for (size_t i = 0; i < count && !failed; i++)
+  {
+    std::unique_ptr<ParsedChunk> chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      parsedOne.wait(lock, [&] { return parsed[i] != nullptr; });
+      chunk        = std::move(parsed[i]);
+      mergedChunks = i + 1;
+    }
+    mergedOne.notify_all();
+
+    if (chunk->failedAt != SIZE_MAX || (closed && format == BULK_JSON))
+    {
+      stats->errorLine = lineOf(data, chunk->failedAt != SIZE_MAX ? chunk->failedAt : bounds[i]);
+      failed           = true;
+      break;
+    }
+    merge.add(*chunk);
+    closed = closed || chunk->closed;
+    file.release(bounds[i + 1]);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  mergedOne.notify_all();
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+
+  if (!failed && !closed)
+  {
+    stats->errorLine = lineOf(data, file.size);
+    failed           = true;
+  }
+  if (failed)
+  {
+    ERR("Couldn't read %s past line %zu", path, stats->errorLine);
+    return false;
+  }
+
+  *entries       = std::move(merged);
+  stats->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  DEBUG("Imported %zu rows from %s in %.3f s, %.0f rows/s", stats->rows, path, stats->seconds,
+        stats->rowsPerSecond());
+  return true;
+}
+
+static void appendCsvField(std::string &out, const char *text, size_t length)
+{
+  if (strcspn(text, ",\"\r\n") >= length)
+  {
+    out.append(text, length);
+    return;
+  }
+  out.push_back('"');
+  for (size_t i = 0; i < length; i++)
+  {
+    if (text[i] == '"') { out.push_back('"'); }
+    out.push_back(text[i]);
+  }
+  out.push_back('"');
+}
+
+static void appendTsvField(std::string &out, const char *text, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    switch (text[i])
+    {
+    case '\t': out += "\\t"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\\': out += "\\\\"; break;
+    default: out.push_back(text[i]); break;
+    }
+  }
+}
+
+void BulkIO::appendJsonString(std::string &out, const char *text, size_t length)
+{
+  static const char digits[] = "0123456789abcdef";
+  out.push_back('"');
+  for (size_t i = 0; i < length; i++)
+  {
+    unsigned char c = (unsigned char)text[i];
+    switch (c)
+    {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (c >= 0x20) { out.push_back((char)c); }
+      else
+      {
+        out += "\\u00";
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xF]);
+      }
+      break;
+    }
+  }
+  out.push_back('"');
+}
+
+static void appendRow(BulkFormat format, std::string &out, const EntryTable &entries, int row)
+{
+  const char *key       = entries.key(row);
+  const char *expansion = entries.expansion(row);
+  bool multiline        = entries.is(row, ENTRY_MULTILINE);
+  bool hidden           = entries.is(row, ENTRY_HIDDEN);
+  bool paste            = entries.is(row, ENTRY_PASTE);
+
+  if (format == BULK_JSON)
+  {
+    out += row == 0 ? "\n  {\"abbreviation\": " : ",\n  {\"abbreviation\": ";
+    BulkIO::appendJsonString(out, key, entries.keys[row].length);
+    out += ", \"expansion\": ";
+    BulkIO::appendJsonString(out, expansion, entries.expansions[row].length);
+    out += multiline ? ", \"multiline\": true" : ", \"multiline\": false";
+    out += hidden ? ", \"hidden\": true" : ", \"hidden\": false";
+    out += paste ? ", \"paste\": true}" : ", \"paste\": false}";
+    return;
+  }
+
+  char delimiter = format == BULK_CSV ? ',' : '\t';
+  if (format == BULK_CSV)
+  {
+    appendCsvField(out, key, entries.keys[row].length);
+    out.push_back(delimiter);
+    appendCsvField(out, expansion, entries.expansions[row].length);
+  }
+  else
+  {
+    appendTsvField(out, key, entries.keys[row].length);
+    out.push_back(delimiter);
+    appendTsvField(out, expansion, entries.expansions[row].length);
+  }
+  out.push_back(delimiter);
+  out.push_back(multiline ? '1' : '0');
+  out.push_back(delimiter);
+  out.push_back(hidden ? '1' : '0');
+  out.push_back(delimiter);
+  out.push_back(paste ? '1' : '0');
+  out.push_back('\n');
+}
+
+bool BulkIO::write(const EntryTable &entries, const char *path, BulkFormat format, BulkStats *stats)
+{
+  using Clock             = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  *stats                  = BulkStats();
+  if (format == BULK_UNKNOWN)
+  {
+    ERR("Don't know what format to write %s in", path);
+    return false;
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    ERR("Failed to open %s", path);
+    return false;
+  }
+
+  std::string buffer;
+  buffer.reserve(BULK_WRITE_BUFFER * 2);
+  if (format == BULK_JSON) { buffer += "["; }
+  else if (format == BULK_CSV) { buffer += "abbreviation,expansion,multiline,hidden,paste\n"; }
+  else { buffer += "abbreviation\texpansion\tmultiline\thidden\tpaste\n"; }
+
+  for (int row = 0; row < entries.size(); row++)
+  {
+    appendRow(format, buffer, entries, row);
+    if (buffer.size() >= BULK_WRITE_BUFFER)
+    {
+      out.write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+  if (format == BULK_JSON) { buffer += entries.size() > 0 ? "\n]\n" : "]\n"; }
+  out.write(buffer.data(), buffer.size());
+
+  out.close();
+  if (!out)
+  {
+    ERR("Failed to write %s", path);
+    return false;
+  }
+
+  stats->rows    = entries.size();
+  stats->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  DEBUG("Exported %zu rows to %s in %.3f s, %.0f rows/s", stats->rows, path, stats->seconds, stats->rowsPerSecond());
+  return true;
+}
@@ -0,0 +1,109 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "ConfigReload.hpp"
+
+#include <string.h>
+
+#include <string_view>
+#include <unordered_map>
+
+#include "Debug.hpp"
+#include "MatcherImage.hpp"
+
+static std::string_view keyOf(const EntryTable &entries, int row)
+{
+  return std::string_view(entries.key(row), entries.keys[row].length);
+}
+
+ConfigReload *ConfigReload::load(const char *path, bool lazy, const EntryTable &current, uint64_t revision)
+{
+  ConfigReload *reload = new ConfigReload();
+  reload->revision     = revision;
+
+  uint64_t size    = 0;
+  int64_t modified = 0;
+  if (!MatcherImage::sourceStamp(path, &reload->size, &reload->modified)) { return reload; }
+
+  // Another version of the app, or a copy of an old config, can still drop a text file here. It
+  // gets read as it is; converting it would mean writing to the file we were just handed.
+  reload->status = SaveFile::read(path, &reload->entries, lazy);
+  if (reload->status == SAVE_FILE_OLDER_FORMAT)
+  {
+    reload->status = SaveFile::readText(path, &reload->entries) ? SAVE_FILE_LOADED : SAVE_FILE_CORRUPT;
+  }
+  else if (reload->status == SAVE_FILE_LOADED && !SaveFile::readChecksum(path, &reload->checksum))
+  {
+    reload->status = SAVE_FILE_CORRUPT;
+  }
+
+  // Replaced again while we were reading it, the watcher will bring us back for the newer one
+  if (!MatcherImage::sourceStamp(path, &size, &modified) || size != reload->size || modified != reload->modified)
+  {
+    DEBUG("%s changed while it was being reloaded", path);
+    reload->status = SAVE_FILE_CORRUPT;
+  }
+  if (reload->status != SAVE_FILE_LOADED)
+  {
+    reload->entries.clear();
+    return reload;
+  }
+
+  // Rows of ours by key, each one chained to the next row with the same key so duplicates get
+  // matched up in order
+  std::unordered_map<std::string_view, int> firstRow;
+  std::vector<int> nextRow(current.size(), -1);
+  firstRow.reserve(current.size());
+  for (int row = (int)current.size() - 1; row >= 0; row--)
+  {
+    auto found = firstRow.try_emplace(keyOf(current, row), row);
+    if (found.second) { continue; }
+    nextRow[row]        = found.first->second;
+    found.first->second = row;
+  }
+
+  EntryTable &entries = reload->entries;
+  std::vector<uint8_t> matched(current.size(), 0);
+  int lastMatch = -1;
+  for (int row = 0; row < entries.size(); row++)
+  {
+    auto found = firstRow.find(keyOf(entries, row));
+    if (found == firstRow.end() || found->second == -1)
+    {
+      entries.ids[row] = -1;
+      reload->added++;
+      continue;
+    }
+
+    int ours           = found->second;
+    found->second      = nextRow[ours];
+    matched[ours]      = 1;
+    entries.ids[row]   = current.ids[ours];
+    size_t length      = entries.expansions[row].length;
+    bool sameExpansion = current.expansions[ours].length == length &&
+                         memcmp(current.expansion(ours), entries.expansion(row), length) == 0;
+    if (!sameExpansion || current.flags[ours] != entries.flags[row]) { reload->changed++; }
+    if (ours < lastMatch) { reload->reordered = true; }
+    lastMatch = ours;
+  }
+
+  for (int row = 0; row < current.size(); row++)
+  {
+    if (!matched[row]) { reload->removed.push_back(current.ids[row]); }
+  }
+
+  DEBUG("Reloaded %s: %zu added, %zu changed, %zu removed%s", path, reload->added, reload->changed,
+        reload->removed.size(), reload->reordered ? ", reordered" : "");
+  return reload;
+}
@@ -47,27 +47,32 @@
   va_list args;                                                                                                        \
   va_start(args, format);                                                                                              \
                                                                                                                        \
+  /* formatting consumes the list on most ABIs, the copy is what we print below */                                     \
+  va_list formatArgs;                                                                                                  \
+  va_copy(formatArgs, args);                                                                                           \
   char buffer[8192]{};                                                                                                 \
-  vsprintf(buffer, with_newline.c_str(), args);                                                                        \
+  vsnprintf(buffer, sizeof(buffer), with_newline.c_str(), formatArgs);                                                 \
+  va_end(formatArgs);                                                                                                  \
   std::string currentLine = buffer;                                                                                    \
                                                                                                                        \
   if (currentLine == Debug::lastLine)                                                                                  \
   {                                                                                                                    \
     Debug::timesRepeated += 1;                                                                                         \
-    printf("\r");                                                                                                      \
+    fprintf(Debug::output, "\r");                                                                                      \
     std::string timesRepeatedString = "  [" + std::to_string(Debug::timesRepeated) + "]";                              \
-    vprintf((prefix + format + timesRepeatedString).c_str(), args);                                                    \
+    vfprintf(Debug::output, (prefix + format + timesRepeatedString).c_str(), args);                                    \
   }                                                                                                                    \
   else                                                                                                                 \
   {                                                                                                                    \
-    printf("\n");                                                                                                      \
+    fprintf(Debug::output, "\n");                                                                                      \
     Debug::timesRepeated = 0;                                                                                          \
-    vprintf(with_newline.c_str(), args);                                                                               \
+    vfprintf(Debug::output, with_newline.c_str(), args);                                                               \
   }                                                                                                                    \
   Debug::lastLine = currentLine;                                                                                       \
   va_end(args);
 
 FILE* Debug::file;
+FILE* Debug::output         = stdout;
 std::string Debug::lastLine = "";
 int Debug::timesRepeated    = 0;
 
@@ -82,34 +87,34 @@ void Debug::init()
   Debug::file = fopen(filename.c_str(), "w+");
 }
 
-void Debug::log(const char* file, int line, std::string format, ...) { PRINT_OUTPUT; }
+void Debug::log(const char* file, int line, const char* format, ...) { PRINT_OUTPUT; }
 
-void Debug::warn(const char* file, int line, std::string format, ...)
+void Debug::warn(const char* file, int line, const char* format, ...)
 {
 #if WIN32
   HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
   SetConsoleTextAttribute(console, YELLOW);
-  printf("[WARN]: ");
+  fprintf(output, "[WARN]: ");
   SetConsoleTextAttribute(console, RESET);
 #else
-  printf(YELLOW);
-  printf("[WARN]: ");
-  printf(RESET);
+  fprintf(output, YELLOW);
+  fprintf(output, "[WARN]: ");
+  fprintf(output, RESET);
 #endif
   PRINT_OUTPUT;
 }
 
-void Debug::error(const char* file, int line, std::string format, ...)
+void Debug::error(const char* file, int line, const char* format, ...)
 {
 #if WIN32
   HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
   SetConsoleTextAttribute(console, RED);
-  printf("[ERROR]: ");
+  fprintf(output, "[ERROR]: ");
   SetConsoleTextAttribute(console, RESET);
 #else
-  printf(RED);
-  printf("[ERROR]: ");
-  printf(RESET);
+  fprintf(output, RED);
+  fprintf(output, "[ERROR]: ");
+  fprintf(output, RESET);
 #endif
   PRINT_OUTPUT;
 }
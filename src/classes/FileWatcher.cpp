@@ -0,0 +1,107 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "FileWatcher.hpp"
+
+#include <filesystem>
+
+#include "Debug.hpp"
+#include "MatcherImage.hpp"
+
+#if __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+void FileWatcher::start(const char *file)
+{
+  stop();
+  path     = file;
+  name     = std::filesystem::path(path).filename().string();
+  watching = true;
+  lastPoll = std::chrono::steady_clock::now();
+  if (!MatcherImage::sourceStamp(path.c_str(), &size, &modified))
+  {
+    size     = 0;
+    modified = 0;
+  }
+
+#if __linux__
+  // The directory rather than the file, a rename over the file replaces the inode a watch on it
+  // would be holding
+  std::string directory = std::filesystem::path(path).parent_path().string();
+  notify                = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify != -1 &&
+      inotify_add_watch(notify, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+  {
+    close(notify);
+    notify = -1;
+  }
+  if (notify == -1) { WARN("Can't watch %s for changes, checking it every %d ms instead", file, FILE_WATCH_POLL_MS); }
+#endif
+}
+
+void FileWatcher::stop()
+{
+#if __linux__
+  if (notify != -1) { close(notify); }
+#endif
+  notify   = -1;
+  watching = false;
+}
+
+bool FileWatcher::changed()
+{
+  if (!watching) { return false; }
+
+#if __linux__
+  if (notify != -1)
+  {
+    // a save is a handful of events, for the temporary file and then the rename; every one of them
+    // gets drained, only ones naming our file count
+    alignas(struct inotify_event) char events[4096];
+    bool seen = false;
+    ssize_t length;
+    while ((length = read(notify, events, sizeof(events))) > 0)
+    {
+      for (char *at = events; at < events + length;)
+      {
+        const struct inotify_event *event = (const struct inotify_event *)at;
+        if (event->len > 0 && name == event->name) { seen = true; }
+        at += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    return seen;
+  }
+#endif
+
+  return poll();
+}
+
+bool FileWatcher::poll()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now - lastPoll < std::chrono::milliseconds(FILE_WATCH_POLL_MS)) { return false; }
+  lastPoll = now;
+
+  // missing, most likely halfway through being replaced; it'll be back by the next poll
+  uint64_t newSize    = 0;
+  int64_t newModified = 0;
+  if (!MatcherImage::sourceStamp(path.c_str(), &newSize, &newModified)) { return false; }
+  if (newSize == size && newModified == modified) { return false; }
+
+  size     = newSize;
+  modified = newModified;
+  return true;
+}
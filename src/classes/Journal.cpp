@@ -0,0 +1,192 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "Journal.hpp"
+
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "Checksum.hpp"
+#include "Debug.hpp"
+
+// length, checksum
+#define JOURNAL_RECORD_HEADER_SIZE (4 + 8)
+
+// type, flags, row, key length, expansion length
+#define JOURNAL_OP_FIXED_SIZE (1 + 1 + 4 + 4 + 4)
+
+static void put32(std::string &out, uint32_t value) { out.append((const char *)&value, sizeof(value)); }
+static void put64(std::string &out, uint64_t value) { out.append((const char *)&value, sizeof(value)); }
+
+static uint32_t get32(const char *bytes)
+{
+  uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+static uint64_t get64(const char *bytes)
+{
+  uint64_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+bool Journal::reset(const char *path, uint64_t baseChecksum)
+{
+  JournalHeader header = {};
+  memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+  header.version      = JOURNAL_VERSION;
+  header.baseChecksum = baseChecksum;
+
+  std::string temporary = std::string(path) + ".tmp";
+  std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+  out.write((const char *)&header, sizeof(header));
+  out.close();
+  if (!out)
+  {
+    ERR("Failed to write %s", temporary.c_str());
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+  {
+    ERR("Failed to replace %s: %s", path, error.message().c_str());
+    return false;
+  }
+  return true;
+}
+
+uint64_t Journal::append(const char *path, const std::vector<JournalOp> &ops)
+{
+  std::string records;
+  std::string payload;
+  for (int i = 0; i < ops.size(); i++)
+  {
+    const JournalOp &op = ops[i];
+    payload.clear();
+    payload.push_back((char)op.type);
+    payload.push_back((char)op.flags);
+    put32(payload, op.row);
+    put32(payload, (uint32_t)op.key.size());
+    payload += op.key;
+    put32(payload, (uint32_t)op.expansion.size());
+    payload += op.expansion;
+
+    put32(records, (uint32_t)payload.size());
+    put64(records, checksum(CHECKSUM_SEED, payload.data(), payload.size()));
+    records += payload;
+  }
+
+  // one write for the whole batch, so a crash tears at most the tail of it
+  std::ofstream out(path, std::ios::binary | std::ios::app);
+  out.write(records.data(), records.size());
+  out.close();
+  if (!out)
+  {
+    ERR("Failed to append to %s", path);
+    return 0;
+  }
+  return records.size();
+}
+
+bool Journal::apply(const JournalOp &op, EntryTable *entries)
+{
+  if (op.type == JOURNAL_DELETE)
+  {
+    if (op.row >= entries->size()) { return false; }
+    entries->erase(op.row);
+    return true;
+  }
+  if (op.type != JOURNAL_UPSERT || op.row > entries->size()) { return false; }
+
+  if (op.row == entries->size())
+  {
+    entries->add(-1, op.key.data(), op.key.size(), op.expansion.data(), op.expansion.size(), op.flags);
+    return true;
+  }
+  entries->setKey(op.row, op.key.data(), op.key.size());
+  entries->setExpansion(op.row, op.expansion.data(), op.expansion.size());
+  entries->flags[op.row] = op.flags;
+  return true;
+}
+
+int Journal::replay(const char *path, uint64_t baseChecksum, EntryTable *entries, uint64_t *size)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) { return -1; }
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  JournalHeader header;
+  if (bytes.size() < sizeof(header)) { return -1; }
+  memcpy(&header, bytes.data(), sizeof(header));
+  if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 || header.version != JOURNAL_VERSION)
+  {
+    WARN("Ignoring %s, it isn't a journal this version understands", path);
+    return -1;
+  }
+  if (header.baseChecksum != baseChecksum)
+  {
+    DEBUG("Ignoring %s, it belongs to an older save file", path);
+    return -1;
+  }
+
+  int applied     = 0;
+  size_t position = sizeof(header);
+  JournalOp op;
+  while (position + JOURNAL_RECORD_HEADER_SIZE <= bytes.size())
+  {
+    uint32_t length    = get32(&bytes[position]);
+    uint64_t expected  = get64(&bytes[position + 4]);
+    const char *record = &bytes[position + JOURNAL_RECORD_HEADER_SIZE];
+    if (length < JOURNAL_OP_FIXED_SIZE || length > bytes.size() - position - JOURNAL_RECORD_HEADER_SIZE) { break; }
+    if (checksum(CHECKSUM_SEED, record, length) != expected) { break; }
+
+    uint32_t keyLength = get32(record + 6);
+    if (keyLength > length - JOURNAL_OP_FIXED_SIZE) { break; }
+    uint32_t expansionLength = get32(record + 10 + keyLength);
+    if (expansionLength != length - JOURNAL_OP_FIXED_SIZE - keyLength) { break; }
+
+    op.type  = (uint8_t)record[0];
+    op.flags = (uint8_t)record[1];
+    op.row   = get32(record + 2);
+    op.key.assign(record + 10, keyLength);
+    op.expansion.assign(record + 14 + keyLength, expansionLength);
+
+    if (entries != nullptr && !apply(op, entries))
+    {
+      WARN("Journal op %d in %s doesn't fit the save file, ignoring the rest", applied, path);
+      break;
+    }
+    applied++;
+    position += JOURNAL_RECORD_HEADER_SIZE + length;
+  }
+
+  if (position < bytes.size())
+  {
+    WARN("Dropping %zu bytes of incomplete journal from %s", bytes.size() - position, path);
+    std::error_code error;
+    std::filesystem::resize_file(path, position, error);
+    if (error) { ERR("Failed to truncate %s: %s", path, error.message().c_str()); }
+  }
+
+  *size = position;
+  return applied;
+}
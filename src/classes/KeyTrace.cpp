@@ -0,0 +1,111 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "KeyTrace.hpp"
+
+#include <string.h>
+
+#include "Debug.hpp"
+
+bool KeyTraceWriter::open(const char *path)
+{
+  close();
+  file = fopen(path, "wb");
+  if (file == nullptr)
+  {
+    ERR("Failed to open %s for the key trace", path);
+    return false;
+  }
+
+  KeyTraceHeader header = {};
+  memcpy(header.magic, KEY_TRACE_MAGIC, sizeof(header.magic));
+  header.version   = KEY_TRACE_VERSION;
+  header.startedAt = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+  fwrite(&header, sizeof(header), 1, file);
+
+  start = Clock::now();
+  last  = 0;
+  buffer.reserve(FLUSH_SIZE + 16);
+  DEBUG("Recording keystrokes to %s", path);
+  return true;
+}
+
+void KeyTraceWriter::flush()
+{
+  if (file == nullptr || buffer.empty()) { return; }
+  fwrite(buffer.data(), 1, buffer.size(), file);
+  buffer.clear();
+}
+
+void KeyTraceWriter::close()
+{
+  if (file == nullptr) { return; }
+  flush();
+  fclose(file);
+  file = nullptr;
+}
+
+bool KeyTraceReader::open(const char *path)
+{
+  close();
+  file = fopen(path, "rb");
+  if (file == nullptr)
+  {
+    ERR("Failed to open the key trace %s", path);
+    return false;
+  }
+
+  if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, KEY_TRACE_MAGIC, 8) != 0 ||
+      header.version != KEY_TRACE_VERSION)
+  {
+    ERR("%s isn't a key trace this version of abbrv understands", path);
+    close();
+    return false;
+  }
+
+  time = 0;
+  return true;
+}
+
+void KeyTraceReader::close()
+{
+  if (file != nullptr) { fclose(file); }
+  file = nullptr;
+}
+
+bool KeyTraceReader::next(KeyEvent *event)
+{
+  if (file == nullptr) { return false; }
+
+  uint64_t delta = 0;
+  int shift      = 0;
+  int byte       = 0;
+  do
+  {
+    byte = getc(file);
+    if (byte == EOF || shift > 63) { return false; }
+    delta |= (uint64_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  int pressed = getc(file);
+  if (pressed == EOF) { return false; }
+
+  time += delta;
+  event->time    = time;
+  event->pressed = (char)pressed;
+  return true;
+}
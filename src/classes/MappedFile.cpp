@@ -0,0 +1,118 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "MappedFile.hpp"
+
+#include "Debug.hpp"
+
+#if !WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if WIN32
+bool MappedFile::open(const char *path)
+{
+  close();
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                     FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) { return false; }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+  {
+    close();
+    return false;
+  }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL)
+  {
+    ERR("Failed to map %s", path);
+    close();
+    return false;
+  }
+
+  data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  size = (size_t)fileSize.QuadPart;
+  if (data == nullptr)
+  {
+    ERR("Failed to map a view of %s", path);
+    close();
+    return false;
+  }
+  return true;
+}
+
+// Unlocking pages that were never locked takes them out of the working set
+void MappedFile::release(size_t offset)
+{
+  if (data != nullptr && offset > 0) { VirtualUnlock((LPVOID)data, offset < size ? offset : size); }
+}
+
+void MappedFile::close()
+{
+  if (data != nullptr) { UnmapViewOfFile(data); }
+  if (mapping != NULL) { CloseHandle(mapping); }
+  if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+  data    = nullptr;
+  size    = 0;
+  mapping = NULL;
+  file    = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::open(const char *path)
+{
+  close();
+  file = ::open(path, O_RDONLY);
+  if (file == -1) { return false; }
+
+  struct stat info;
+  if (fstat(file, &info) != 0 || info.st_size == 0)
+  {
+    close();
+    return false;
+  }
+
+  void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+  if (view == MAP_FAILED)
+  {
+    ERR("Failed to map %s", path);
+    close();
+    return false;
+  }
+
+  data = (const char *)view;
+  size = (size_t)info.st_size;
+  return true;
+}
+
+void MappedFile::release(size_t offset)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  offset      = (offset < size ? offset : size) / page * page;
+  if (data != nullptr && offset > 0) { madvise((void *)data, offset, MADV_DONTNEED); }
+}
+
+void MappedFile::close()
+{
+  if (data != nullptr) { munmap((void *)data, size); }
+  if (file != -1) { ::close(file); }
+  data = nullptr;
+  size = 0;
+  file = -1;
+}
+#endif
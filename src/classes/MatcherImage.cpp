@@ -0,0 +1,287 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "MatcherImage.hpp"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Checksum.hpp"
+#include "Debug.hpp"
+#include "Matcher.hpp"
+
+// every section starts on an 8 byte boundary so the mapped arrays are properly aligned
+static uint64_t alignSection(uint64_t offset) { return (offset + 7) & ~(uint64_t)7; }
+
+// Flags an entry in an image can have. Its expansions are all in the string section, so never
+// SNAPSHOT_ENTRY_STORED, which would have the hook read them through a store the image doesn't have.
+#define IMAGE_ENTRY_FLAGS                                                                                              \
+  (SNAPSHOT_ENTRY_LIVE | SNAPSHOT_ENTRY_MULTILINE | SNAPSHOT_ENTRY_HIDDEN | SNAPSHOT_ENTRY_PASTE)
+
+uint64_t MatcherImage::headerChecksum(const MatcherImageHeader &header)
+{
+  return checksum(CHECKSUM_SEED, &header, offsetof(MatcherImageHeader, checksum));
+}
+
+uint64_t MatcherImage::sectionsChecksum(const MatcherSnapshot &snapshot)
+{
+  const DoubleArrayTrie &compact = snapshot.compact;
+  size_t arraySize               = (size_t)compact.size * sizeof(int32_t);
+
+  uint64_t hash = CHECKSUM_SEED;
+  hash          = checksum(hash, compact.base, arraySize);
+  hash          = checksum(hash, compact.check, arraySize);
+  hash          = checksum(hash, compact.fail, arraySize);
+  hash          = checksum(hash, compact.output, arraySize);
+  hash          = checksum(hash, snapshot.entries, (size_t)snapshot.entryCount * sizeof(SnapshotEntry));
+  return checksum(hash, snapshot.strings, snapshot.stringsSize);
+}
+
+// DoubleArrayTrie::next follows fail links until a transition fits, and only stops early at the
+// root. That terminates because a built trie's links always lead somewhere shallower, which a
+// damaged image can't be trusted to keep to, so it's checked here: depths come from a breadth first
+// walk down the check array, and every state's link has to point strictly above it.
+static bool failLinksRise(const DoubleArrayTrie &compact)
+{
+  const int32_t ROOT  = DoubleArrayTrie::ROOT;
+  const int32_t EMPTY = DoubleArrayTrie::EMPTY;
+  int32_t size        = compact.size;
+  if (compact.check[ROOT] != EMPTY || compact.fail[ROOT] != ROOT) { return false; }
+
+  // the children of every state, grouped by parent
+  std::vector<int32_t> firstChild(size + 1, 0);
+  for (int32_t slot = 0; slot < size; slot++)
+  {
+    if (compact.check[slot] != EMPTY) { firstChild[compact.check[slot] + 1]++; }
+  }
+  for (int32_t state = 0; state < size; state++)
+  {
+    firstChild[state + 1] += firstChild[state];
+  }
+  std::vector<int32_t> children(firstChild[size]);
+  std::vector<int32_t> filled(firstChild.begin(), firstChild.end() - 1);
+  for (int32_t slot = 0; slot < size; slot++)
+  {
+    if (compact.check[slot] != EMPTY) { children[filled[compact.check[slot]]++] = slot; }
+  }
+
+  std::vector<int32_t> depth(size, -1);
+  std::vector<int32_t> queue;
+  depth[ROOT] = 0;
+  queue.push_back(ROOT);
+  for (size_t head = 0; head < queue.size(); head++)
+  {
+    int32_t state = queue[head];
+    for (int32_t i = firstChild[state]; i < firstChild[state + 1]; i++)
+    {
+      int32_t child = children[i];
+      if (depth[child] != -1) { continue; }
+      depth[child] = depth[state] + 1;
+      queue.push_back(child);
+    }
+  }
+
+  // a state the root can't reach is a check cycle, which no built trie has either
+  for (int32_t slot = 0; slot < size; slot++)
+  {
+    if (slot == ROOT || compact.check[slot] == EMPTY) { continue; }
+    int32_t fail = compact.fail[slot];
+    if (depth[slot] == -1 || depth[fail] == -1 || depth[fail] >= depth[slot]) { return false; }
+  }
+  return true;
+}
+
+bool MatcherImage::sourceStamp(const char *path, uint64_t *size, int64_t *modified)
+{
+  std::error_code error;
+  uintmax_t fileSize = std::filesystem::file_size(path, error);
+  if (error) { return false; }
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+  if (error) { return false; }
+
+  *size     = (uint64_t)fileSize;
+  *modified = (int64_t)time.time_since_epoch().count();
+  return true;
+}
+
+bool MatcherImage::write(const MatcherSnapshot &snapshot, const std::string &path, uint64_t sourceSize,
+                         int64_t sourceModified)
+{
+  if (snapshot.engine != ENGINE_DOUBLE_ARRAY)
+  {
+    WARN("Only double array snapshots can be written as an image");
+    return false;
+  }
+
+  MatcherImageHeader header = {};
+  memcpy(header.magic, MATCHER_IMAGE_MAGIC, sizeof(header.magic));
+  header.version          = MATCHER_IMAGE_VERSION;
+  header.engine           = (uint32_t)snapshot.engine;
+  header.sourceSize       = sourceSize;
+  header.sourceModified   = sourceModified;
+  header.slotCount        = (uint32_t)snapshot.compact.size;
+  header.keyCount         = (uint32_t)snapshot.compact.keyCount;
+  header.entryCount       = snapshot.entryCount;
+  header.arraysOffset     = alignSection(sizeof(MatcherImageHeader));
+  header.entriesOffset    = alignSection(header.arraysOffset + (uint64_t)header.slotCount * 4 * sizeof(int32_t));
+  header.stringsOffset    = alignSection(header.entriesOffset + (uint64_t)header.entryCount * sizeof(SnapshotEntry));
+  header.stringsSize      = snapshot.stringsSize;
+  header.sectionsChecksum = sectionsChecksum(snapshot);
+  header.checksum         = headerChecksum(header);
+
+  std::string temporary = path + ".tmp";
+  std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    ERR("Failed to open %s", temporary.c_str());
+    return false;
+  }
+
+  const char padding[8] = {};
+  auto section          = [&](uint64_t offset, const void *data, uint64_t size) {
+    out.write(padding, offset - (uint64_t)out.tellp());
+    out.write((const char *)data, size);
+  };
+
+  out.write((const char *)&header, sizeof(header));
+  section(header.arraysOffset, snapshot.compact.base, (uint64_t)header.slotCount * sizeof(int32_t));
+  out.write((const char *)snapshot.compact.check, (uint64_t)header.slotCount * sizeof(int32_t));
+  out.write((const char *)snapshot.compact.fail, (uint64_t)header.slotCount * sizeof(int32_t));
+  out.write((const char *)snapshot.compact.output, (uint64_t)header.slotCount * sizeof(int32_t));
+  section(header.entriesOffset, snapshot.entries, (uint64_t)header.entryCount * sizeof(SnapshotEntry));
+  section(header.stringsOffset, snapshot.strings, header.stringsSize);
+  out.close();
+  if (!out)
+  {
+    ERR("Failed to write %s", temporary.c_str());
+    return false;
+  }
+
+  // On Windows this fails while the previous image is still mapped. That's fine, the old snapshot
+  // gets reclaimed shortly and the next rebuild will manage to replace it.
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+  {
+    WARN("Couldn't replace %s: %s", path.c_str(), error.message().c_str());
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+
+  DEBUG("Wrote matcher image %s", path.c_str());
+  return true;
+}
+
+MatcherSnapshot *MatcherImage::load(const char *path, uint64_t sourceSize, int64_t sourceModified)
+{
+  MatcherSnapshot *snapshot = new MatcherSnapshot();
+  if (!snapshot->image.open(path))
+  {
+    delete snapshot;
+    return nullptr;
+  }
+
+  const char *data = snapshot->image.data;
+  uint64_t size    = snapshot->image.size;
+  const MatcherImageHeader *header = (const MatcherImageHeader *)data;
+
+  // Everything below is bounds checking. The keyboard hook indexes straight into these arrays,
+  // so an image that doesn't add up is thrown away and we fall back to parsing the save file.
+  const char *problem = nullptr;
+  if (size < sizeof(MatcherImageHeader)) { problem = "it is truncated"; }
+  else if (memcmp(header->magic, MATCHER_IMAGE_MAGIC, sizeof(header->magic)) != 0) { problem = "bad magic"; }
+  else if (header->version != MATCHER_IMAGE_VERSION) { problem = "it is an older version"; }
+  else if (header->checksum != headerChecksum(*header)) { problem = "the header is corrupt"; }
+  else if (header->engine != ENGINE_DOUBLE_ARRAY) { problem = "unknown engine"; }
+  else if (header->sourceSize != sourceSize || header->sourceModified != sourceModified)
+  {
+    problem = "the save file changed since it was built";
+  }
+  else if (header->slotCount == 0 || header->slotCount > INT32_MAX || header->entryCount > INT32_MAX)
+  {
+    problem = "bad counts";
+  }
+  else if (header->arraysOffset % 8 || header->entriesOffset % 8) { problem = "misaligned sections"; }
+  else if (header->arraysOffset + (uint64_t)header->slotCount * 4 * sizeof(int32_t) > header->entriesOffset ||
+           header->entriesOffset + (uint64_t)header->entryCount * sizeof(SnapshotEntry) > header->stringsOffset ||
+           header->stringsOffset + header->stringsSize > size)
+  {
+    problem = "sections overrun the file";
+  }
+
+  if (problem == nullptr)
+  {
+    snapshot->engine = ENGINE_DOUBLE_ARRAY;
+    snapshot->compact.view((const int32_t *)(data + header->arraysOffset), (int32_t)header->slotCount);
+    snapshot->compact.keyCount = (int32_t)header->keyCount;
+    snapshot->entries          = (const SnapshotEntry *)(data + header->entriesOffset);
+    snapshot->entryCount       = header->entryCount;
+    snapshot->strings          = data + header->stringsOffset;
+    snapshot->stringsSize      = header->stringsSize;
+
+    // ids of deleted entries are holes with nothing in the string section
+    for (uint32_t i = 0; i < snapshot->entryCount && problem == nullptr; i++)
+    {
+      const SnapshotEntry &entry = snapshot->entries[i];
+      if (entry.flags & ~IMAGE_ENTRY_FLAGS)
+      {
+        problem = "an entry has flags it can't have";
+        break;
+      }
+      if (!(entry.flags & SNAPSHOT_ENTRY_LIVE)) { continue; }
+      if ((uint64_t)entry.keyOffset + entry.keyLength >= snapshot->stringsSize ||
+          (uint64_t)entry.expansionOffset + entry.expansionLength >= snapshot->stringsSize ||
+          snapshot->strings[entry.keyOffset + entry.keyLength] != '\0' ||
+          snapshot->strings[entry.expansionOffset + entry.expansionLength] != '\0')
+      {
+        problem = "an entry points outside the string section";
+      }
+    }
+
+    const DoubleArrayTrie &compact = snapshot->compact;
+    for (int32_t slot = 0; slot < compact.size && problem == nullptr; slot++)
+    {
+      int32_t output = compact.output[slot];
+      if (compact.base[slot] < 0 || compact.base[slot] > INT32_MAX - DoubleArrayTrie::LABEL_COUNT ||
+          compact.check[slot] < DoubleArrayTrie::EMPTY || compact.check[slot] >= compact.size ||
+          compact.fail[slot] < 0 || compact.fail[slot] >= compact.size || output < DoubleArrayTrie::NO_MATCH ||
+          output >= (int32_t)snapshot->entryCount ||
+          (output != DoubleArrayTrie::NO_MATCH && !(snapshot->entries[output].flags & SNAPSHOT_ENTRY_LIVE)))
+      {
+        problem = "a state points outside the arrays";
+      }
+    }
+
+    if (problem == nullptr && header->sectionsChecksum != sectionsChecksum(*snapshot))
+    {
+      problem = "the checksum doesn't match";
+    }
+    if (problem == nullptr && !failLinksRise(compact)) { problem = "its fail links could loop"; }
+  }
+
+  if (problem != nullptr)
+  {
+    WARN("Ignoring matcher image %s, %s", path, problem);
+    delete snapshot;
+    return nullptr;
+  }
+
+  DEBUG("Mapped matcher image %s, %u entries", path, snapshot->entryCount);
+  return snapshot;
+}
@@ -48,7 +48,11 @@ Platform::~Platform() {}
 
 void Platform::init()
 {
-  data = new AppData();
+  data             = new AppData();
+  data->engine     = engine;
+  data->lazyBodies = lazyBodies;
+  data->pasteAbove = pasteAbove;
+  currentKeyMap(); // before init() so the first snapshot is already planned
   data->init();
   int screenWidth, screenHeight;
   SDL_GetWindowSize(window, &screenWidth, &screenHeight);
@@ -468,7 +472,10 @@ void Platform::handleOSEvents(Input* input)
 
 void Platform::cleanUp()
 {
+  data->shutdown();
+  keyTrace.close();
 #if WIN32
+  restoreClipboard(true);
   removeTrayIcon(window);
 #endif
   SDL_GL_DeleteContext(context);
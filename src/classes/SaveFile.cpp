@@ -0,0 +1,494 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#include "SaveFile.hpp"
+
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "Checksum.hpp"
+#include "Debug.hpp"
+#include "MappedFile.hpp"
+#include "Serialization.hpp"
+
+// Bytes are handed to the file and the checksum this many at a time
+#define SAVE_FILE_WRITE_CHUNK (64 * 1024)
+
+// How far a migration gets between progress reports
+#define SAVE_FILE_MIGRATION_REPORT_BYTES (4 * 1024 * 1024)
+
+static bool replace(const std::string &temporary, const char *path)
+{
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+#if WIN32
+  // Windows won't replace a file that's still mapped, which it is while lazy bodies are being
+  // read out of it. It will let it be moved aside though, and we keep reading it from there.
+  if (error)
+  {
+    std::string aside = std::string(path) + ".old";
+    std::filesystem::remove(aside, error);
+    std::filesystem::rename(path, aside, error);
+    if (!error) { std::filesystem::rename(temporary, path, error); }
+  }
+#endif
+  if (error)
+  {
+    ERR("Failed to replace %s: %s", path, error.message().c_str());
+    return false;
+  }
+  DEBUG("Saved our entries.");
+  return true;
+}
+
+// Buffers a save file on its way to disk and checksums it as it goes
+class SaveFileOutput
+{
+public:
+  bool open(const std::string &path)
+  {
+    out.open(path, std::ios::binary | std::ios::trunc);
+    return (bool)out;
+  }
+
+  void write(const void *data, size_t size)
+  {
+    pending.append((const char *)data, size);
+    if (pending.size() < SAVE_FILE_WRITE_CHUNK) { return; }
+    size_t words = pending.size() & ~(sizeof(uint64_t) - 1);
+    hash         = checksum(hash, pending.data(), words);
+    out.write(pending.data(), words);
+    pending.erase(0, words);
+  }
+
+  void writeLength(size_t length)
+  {
+    uint32_t value = (uint32_t)length;
+    write(&value, sizeof(value));
+  }
+
+  // followed by a NUL, which the lengths don't count
+  void writeString(const char *text, size_t length)
+  {
+    write(text, length);
+    write("", 1);
+  }
+
+  // Appends the checksum and closes the file
+  bool finish(uint64_t *written = nullptr)
+  {
+    hash = checksum(hash, pending.data(), pending.size());
+    out.write(pending.data(), pending.size());
+    out.write((const char *)&hash, sizeof(hash));
+    out.close();
+    if (written != nullptr) { *written = hash; }
+    return (bool)out;
+  }
+
+private:
+  std::ofstream out;
+  std::string pending;
+  uint64_t hash = CHECKSUM_SEED;
+};
+
+static SaveFileHeader makeHeader()
+{
+  SaveFileHeader header = {};
+  memcpy(header.magic, ABBRV_SAVE_MAGIC, sizeof(header.magic));
+  return header;
+}
+
+bool SaveFile::write(const EntryTable &entries, const char *path, uint64_t *checksum)
+{
+  std::string temporary = std::string(path) + ".tmp";
+  SaveFileOutput out;
+  if (!out.open(temporary))
+  {
+    ERR("Failed to open the config file %s", temporary.c_str());
+    return false;
+  }
+
+  SaveFileHeader header = makeHeader();
+  header.entryCount     = entries.size();
+  for (int i = 0; i < entries.size(); i++)
+  {
+    header.keysSize += entries.keys[i].length + 1;
+    header.expansionsSize += entries.expansions[i].length + 1;
+  }
+
+  out.write(&header, sizeof(header));
+  out.write(entries.flags.data(), entries.flags.size());
+  for (int i = 0; i < entries.size(); i++)
+  {
+    out.writeLength(entries.keys[i].length);
+  }
+  for (int i = 0; i < entries.size(); i++)
+  {
+    out.writeLength(entries.expansions[i].length);
+  }
+  for (int i = 0; i < entries.size(); i++)
+  {
+    out.writeString(entries.key(i), entries.keys[i].length);
+  }
+  for (int i = 0; i < entries.size(); i++)
+  {
+    out.writeString(entries.expansion(i), entries.expansions[i].length);
+  }
+
+  if (!out.finish(checksum))
+  {
+    ERR("Failed to write the config file %s", temporary.c_str());
+    return false;
+  }
+  return replace(temporary, path);
+}
+
+bool SaveFile::readChecksum(const char *path, uint64_t *checksum)
+{
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(ABBRV_SAVE_MAGIC) - 1];
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, ABBRV_SAVE_MAGIC, sizeof(magic)) != 0) { return false; }
+
+  uint64_t trailer = 0;
+  in.seekg(0, std::ios::end);
+  if (!in || (uint64_t)in.tellg() < sizeof(SaveFileHeader) + sizeof(trailer)) { return false; }
+  in.seekg(-(std::streamoff)sizeof(trailer), std::ios::end);
+  if (!in.read((char *)&trailer, sizeof(trailer))) { return false; }
+
+  *checksum = trailer;
+  return true;
+}
+
+static uint32_t get32(const char *bytes)
+{
+  uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+SaveFileStatus SaveFile::read(const char *path, EntryTable *entries, bool lazy)
+{
+  if (!std::filesystem::exists(path)) { return SAVE_FILE_MISSING; }
+
+  // Loading eagerly the store only lives until we return, which closes the file again
+  std::shared_ptr<ExpansionStore> store = std::make_shared<ExpansionStore>();
+  MappedFile &file                      = store->file;
+  if (!file.open(path) || file.size < sizeof(ABBRV_SAVE_MAGIC) - 1 ||
+      memcmp(file.data, ABBRV_SAVE_MAGIC, sizeof(ABBRV_SAVE_MAGIC) - 1) != 0)
+  {
+    // mapping an empty file fails too, which is as good as an empty file in the text format
+    return SAVE_FILE_OLDER_FORMAT;
+  }
+
+  const char *problem = nullptr;
+  SaveFileHeader header;
+  uint64_t trailer = 0;
+  if (file.size < sizeof(header) + sizeof(trailer)) { problem = "too short"; }
+  else
+  {
+    memcpy(&header, file.data, sizeof(header));
+    memcpy(&trailer, file.data + file.size - sizeof(trailer), sizeof(trailer));
+
+    // flags, key length and expansion length
+    uint64_t body = file.size - sizeof(header) - sizeof(trailer);
+    uint64_t rows = header.entryCount <= body / 9 ? header.entryCount * 9 : UINT64_MAX;
+    if (rows > body || header.keysSize > body - rows || header.expansionsSize != body - rows - header.keysSize)
+    {
+      problem = "sections don't add up";
+    }
+    // A lazy load is about not touching the expansions, so the checksum can't be checked. The
+    // bounds still are, and the last expansion's NUL stops anything reading past the section.
+    else if (!lazy && checksum(CHECKSUM_SEED, file.data, file.size - sizeof(trailer)) != trailer)
+    {
+      problem = "checksum mismatch";
+    }
+    else if (header.expansionsSize > 0 && file.data[file.size - sizeof(trailer) - 1] != '\0')
+    {
+      problem = "unterminated expansion";
+    }
+  }
+  if (problem != nullptr)
+  {
+    ERR("Can't load %s: %s", path, problem);
+    return SAVE_FILE_CORRUPT;
+  }
+
+  // everything below stays inside the sections, the checks above make sure they're in the file
+  const uint8_t *flags         = (const uint8_t *)file.data + sizeof(header);
+  const char *keyLengths       = (const char *)flags + header.entryCount;
+  const char *expansionLengths = keyLengths + header.entryCount * sizeof(uint32_t);
+  const char *keys             = expansionLengths + header.entryCount * sizeof(uint32_t);
+  const char *expansions       = keys + header.keysSize;
+  uint64_t keyOffset           = 0;
+  uint64_t expansionOffset     = 0;
+  store->base                  = expansions;
+
+  // store offsets are 32 bit like the arena's, so a section past that gets loaded the usual way
+  if (lazy && (header.expansionsSize > UINT32_MAX || entries->store != nullptr)) { lazy = false; }
+  if (lazy) { entries->store = store; }
+
+  size_t before = entries->size();
+  entries->reserve(before + header.entryCount);
+  for (uint64_t i = 0; i < header.entryCount; i++)
+  {
+    uint32_t keyLength       = get32(keyLengths + i * sizeof(uint32_t));
+    uint32_t expansionLength = get32(expansionLengths + i * sizeof(uint32_t));
+    if (header.keysSize - keyOffset <= keyLength || keys[keyOffset + keyLength] != '\0' ||
+        header.expansionsSize - expansionOffset <= expansionLength ||
+        (!lazy && expansions[expansionOffset + expansionLength] != '\0'))
+    {
+      problem = "an entry runs past the end of its section";
+      break;
+    }
+
+    uint8_t flag = flags[i] & (ENTRY_MULTILINE | ENTRY_HIDDEN | ENTRY_PASTE);
+    if (lazy)
+    {
+      StringRef expansion = {(uint32_t)expansionOffset, expansionLength};
+      entries->addStored(-1, keys + keyOffset, keyLength, expansion, flag);
+    }
+    else { entries->add(-1, keys + keyOffset, keyLength, expansions + expansionOffset, expansionLength, flag); }
+    keyOffset += keyLength + 1;
+    expansionOffset += expansionLength + 1;
+  }
+  if (problem == nullptr && (keyOffset != header.keysSize || expansionOffset != header.expansionsSize))
+  {
+    problem = "trailing bytes after the last entry";
+  }
+
+  if (problem != nullptr)
+  {
+    ERR("Can't load %s: %s", path, problem);
+    while (entries->size() > before)
+    {
+      entries->erase((int)entries->size() - 1);
+    }
+    if (lazy) { entries->store.reset(); }
+    return SAVE_FILE_CORRUPT;
+  }
+
+  DEBUG("Loaded %llu entries from %s%s", (unsigned long long)header.entryCount, path,
+        lazy ? ", expansions left on disk" : "");
+  return SAVE_FILE_LOADED;
+}
+
+bool SaveFile::writeText(const EntryTable &entries, const char *path)
+{
+  std::string temporary = std::string(path) + ".tmp";
+  std::ofstream out;
+  out.open(temporary);
+  if (!out)
+  {
+    ERR("Failed to open the config file %s", temporary.c_str());
+    return false;
+  }
+
+  WRITE(ABBRV_SAVE_FILE_VERSION);
+  WRITE(entries.size());
+
+  for (int i = 0; i < entries.size(); i++)
+  {
+    START_WRITE("{");
+    WRITE_AS("entries[i].isHiddenField", entries.is(i, ENTRY_HIDDEN));
+    WRITE_AS("entries[i].isMultiline", entries.is(i, ENTRY_MULTILINE));
+    WRITE_AS("entries[i].abbreviation", entries.key(i));
+    WRITE_AS("entries[i].expandsTo", entries.expansion(i));
+    END_WRITE("}");
+  }
+
+  out.close();
+  if (!out)
+  {
+    ERR("Failed to write the config file %s", temporary.c_str());
+    return false;
+  }
+  return replace(temporary, path);
+}
+
+TextRecordReader::TextRecordReader(const char *data, size_t size) : data(data), fields(data, size)
+{
+  // ABBRV_SAVE_1_0 starts with its version and entry count, the unversioned format goes straight
+  // into the entries
+  FieldReader peek = fields;
+  std::string_view field;
+  std::string_view label;
+  std::string_view value;
+  versioned = peek.next(&field) && FieldReader::split(field, &label, &value) && label == "ABBRV_SAVE_FILE_VERSION";
+  if (!versioned) { return; }
+
+  if (value != ABBRV_SAVE_FILE_VERSION || !peek.next(&field) || !FieldReader::split(field, &label, &value))
+  {
+    failed = true;
+    return;
+  }
+  remaining = atoi(std::string(value).c_str());
+  fields    = peek;
+}
+
+bool TextRecordReader::next(TextRecord *record)
+{
+  std::string_view field;
+  std::string_view label;
+  std::string_view value;
+  *record = {};
+
+  if (versioned)
+  {
+    // {, the four fields in any order, }
+    if (remaining <= 0 || !fields.next(&field)) { return false; }
+    remaining--;
+    while (fields.next(&field) && field != "}")
+    {
+      if (!FieldReader::split(field, &label, &value)) { continue; }
+      bool set = !value.empty() && value != "0";
+      if (label == "entries[i].isHiddenField" && set) { record->flags |= ENTRY_HIDDEN; }
+      else if (label == "entries[i].isMultiline" && set) { record->flags |= ENTRY_MULTILINE; }
+      else if (label == "entries[i].abbreviation") { record->key = value; }
+      else if (label == "entries[i].expandsTo") { record->expansion = value; }
+    }
+    return true;
+  }
+
+  // The old reader did `in >> isMultiline` and then two getlines, so the flag and the key share a
+  // field and the expansion is taken as is, leading whitespace and all. Records with an empty key
+  // were skipped.
+  while (fields.next(&field))
+  {
+    size_t digits = field.find_first_not_of("0123456789");
+    if (digits == std::string_view::npos) { digits = field.size(); }
+    std::string_view multiline = field.substr(0, digits);
+    while (multiline.size() > 1 && multiline[0] == '0')
+    {
+      multiline.remove_prefix(1);
+    }
+    if (multiline != "0" && multiline != "1")
+    {
+      failed = true;
+      return false;
+    }
+
+    record->key = field.substr(digits);
+    while (!record->key.empty() && isspace((unsigned char)record->key[0]))
+    {
+      record->key.remove_prefix(1);
+    }
+    if (!fields.next(&record->expansion, false)) { record->expansion = {}; }
+    if (record->key.empty()) { continue; }
+
+    record->flags = multiline == "1" ? ENTRY_MULTILINE : 0;
+    return true;
+  }
+  return false;
+}
+
+bool SaveFile::readText(const char *path, EntryTable *entries)
+{
+  MappedFile file;
+  if (!file.open(path)) { return false; }
+
+  TextRecordReader reader(file.data, file.size);
+  TextRecord record;
+  int count = 0;
+  while (reader.next(&record))
+  {
+    entries->add(-1, record.key.data(), record.key.size(), record.expansion.data(), record.expansion.size(),
+                 record.flags);
+    count++;
+  }
+  if (reader.failed) { ERR("Couldn't read %s past byte %zu", path, reader.position()); }
+  return !reader.failed || count > 0;
+}
+
+bool SaveFile::migrate(const char *path, MigrationProgress progress)
+{
+  // an empty file maps to nothing, which is an empty dictionary
+  MappedFile file;
+  file.open(path);
+  size_t total      = 3 * file.size;
+  size_t nextReport = 0;
+  auto report       = [&](int pass, size_t position) {
+    size_t done = pass * file.size + position;
+    if (done < nextReport) { return; }
+    if (progress != nullptr) { progress(done, total); }
+    file.release(position);
+    nextReport = done + SAVE_FILE_MIGRATION_REPORT_BYTES;
+  };
+
+  // sizing pass, the columns have to be written before any of the text
+  SaveFileHeader header = makeHeader();
+  std::vector<uint8_t> flags;
+  std::vector<uint32_t> keyLengths;
+  std::vector<uint32_t> expansionLengths;
+  TextRecordReader sizing(file.data, file.size);
+  TextRecord record;
+  while (sizing.next(&record))
+  {
+    flags.push_back(record.flags);
+    keyLengths.push_back((uint32_t)record.key.size());
+    expansionLengths.push_back((uint32_t)record.expansion.size());
+    header.keysSize += record.key.size() + 1;
+    header.expansionsSize += record.expansion.size() + 1;
+    report(0, sizing.position());
+  }
+  header.entryCount = flags.size();
+  if (sizing.failed)
+  {
+    if (flags.empty())
+    {
+      ERR("Can't migrate %s, it isn't a save file this version understands", path);
+      return false;
+    }
+    ERR("Couldn't read %s past byte %zu, migrating the %zu entries before that", path, sizing.position(),
+        flags.size());
+  }
+
+  std::string temporary = std::string(path) + ".tmp";
+  SaveFileOutput out;
+  if (!out.open(temporary))
+  {
+    ERR("Failed to open the config file %s", temporary.c_str());
+    return false;
+  }
+  out.write(&header, sizeof(header));
+  out.write(flags.data(), flags.size());
+  out.write(keyLengths.data(), keyLengths.size() * sizeof(uint32_t));
+  out.write(expansionLengths.data(), expansionLengths.size() * sizeof(uint32_t));
+
+  // a pass for the keys and one for the expansions, each stopping wherever the sizing pass did
+  for (int pass = 1; pass <= 2; pass++)
+  {
+    TextRecordReader writing(file.data, file.size);
+    for (size_t i = 0; i < flags.size() && writing.next(&record); i++)
+    {
+      if (pass == 1) { out.writeString(record.key.data(), record.key.size()); }
+      else { out.writeString(record.expansion.data(), record.expansion.size()); }
+      report(pass, writing.position());
+    }
+  }
+  if (progress != nullptr) { progress(total, total); }
+
+  if (!out.finish())
+  {
+    ERR("Failed to write the config file %s", temporary.c_str());
+    return false;
+  }
+
+  // the old file has to be unmapped before Windows lets it be replaced
+  file.close();
+  DEBUG("Migrated %zu entries from %s", flags.size(), path);
+  return replace(temporary, path);
+}
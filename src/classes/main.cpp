@@ -13,6 +13,8 @@
  **/
 #include <SDL2/SDL.h>
 
+#include <string.h>
+
 #include "AppData.hpp"
 #include "Debug.hpp"
 #include "Editor.hpp"
@@ -30,8 +32,30 @@ int main(int argc, char* args[])
   int countFrequency = SDL_GetPerformanceFrequency();
   float deltaTime    = 0.0f;
   Debug::init();
+
+  const char* keyTracePath = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(args[i], "--engine") == 0 && hasValue)
+    {
+      if (!parseEngine(args[++i], &Platform::engine)) { ERR("Unknown matcher engine %s", args[i]); }
+    }
+    else if (strcmp(args[i], "--record-keys") == 0 && hasValue) { keyTracePath = args[++i]; }
+    else if (strcmp(args[i], "--lazy-bodies") == 0) { Platform::lazyBodies = true; }
+    else if (strcmp(args[i], "--unicode-input") == 0) { Platform::unicodeInput = true; }
+    else if (strcmp(args[i], "--paste-above") == 0 && hasValue)
+    {
+      Platform::pasteAbove = std::max(0, atoi(args[++i])); // characters, 0 to only paste entries marked for it
+    }
+  }
+
   platform->init();
 
+  // Records every keystroke the hook sees, for replaying a real session with abbrv_replay. This
+  // is a key logger, so it is strictly opt in and the file never leaves the machine.
+  if (keyTracePath != nullptr) { platform->keyTrace.open(keyTracePath); }
+
 
   while (platform->isRunning)
   {
@@ -42,6 +66,15 @@ int main(int argc, char* args[])
     platform->frameStart(input);
 
     Editor::render(platform, input, platform->data);
+    if (!Editor::anInputIsActive)
+    {
+      platform->currentKeyMap();
+      platform->data->refreshMatcher();
+      platform->data->watchSaveFile();
+    }
+    platform->data->persist();
+    platform->keyTrace.writeBuffered();
+    platform->restoreClipboard();
 
     platform->frameEnd();
 
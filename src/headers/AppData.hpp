@@ -16,191 +16,309 @@
 #ifndef DATA_HPP
 #define DATA_HPP
 
-#define ABBREVIATION_MAX_SIZE 1024
-#define EXPAND_MAX_SIZE       4096
+// ToAscii reports both alt and ctrl as -52, and shift being released as 0. Neither should count as
+// a break in whatever the user is typing, so the hook ignores them.
+#define KEY_MODIFIER_PRESSED -52
+#define KEY_SHIFT_RELEASED   0
 
-// we allow all ASCII entries
-#define ALPHABET_SIZE           128
-#define ABBRV_SAVE_FILE_VERSION "ABBRV_SAVE_1_0"
-#define SAVE_FILE_NAME          "config.abbrv"
+#include <stdlib.h>
+#include <string.h>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#include "Arena.hpp"
+#include "BulkIO.hpp"
+#include "ConfigReload.hpp"
 #include "Debug.hpp"
+#include "EntryTable.hpp"
+#include "FileWatcher.hpp"
+#include "Injection.hpp"
+#include "Journal.hpp"
+#include "Matcher.hpp"
+#include "MatcherImage.hpp"
+#include "SaveFile.hpp"
 #include "Serialization.hpp"
-#include "imgui.h"
+#include "Trie.hpp"
 
-struct Abbreviation
+class AppData
 {
-  char abbreviation[ABBREVIATION_MAX_SIZE];
-  char expandsTo[EXPAND_MAX_SIZE];
-  bool isMultiline;
-  bool isHiddenField = false;
-};
+public:
+  void init()
+  {
+    if (!usesImage() || !loadImage()) { readSaveFile(); }
+    MatcherImage::sourceStamp(SAVE_FILE_NAME, &loadedSize, &loadedModified);
+    watcher.start(SAVE_FILE_NAME);
+  }
 
-struct TrieNode
-{
-  bool terminal;
-  Abbreviation *abbreviation;
-  TrieNode *children[ALPHABET_SIZE];
+  // Only the double array is plain enough to map straight back in. The image holds a copy of every
+  // expansion, the opposite of what lazy bodies are for.
+  bool usesImage() const { return engine == ENGINE_DOUBLE_ARRAY && !lazyBodies; }
 
-  static void insert(TrieNode *root, std::string key, Abbreviation *abbreviation)
+  // What a matcher image gets stamped with: the save file, plus the journal of edits on top of it.
+  // Appending to the journal grows it, and compacting rewrites both, so any write to either makes
+  // an older image stale.
+  static bool sourceStamp(uint64_t *size, int64_t *modified)
   {
-    DEBUG("Inserting %s into Trie", key.c_str());
-    TrieNode *current = root;
+    if (!MatcherImage::sourceStamp(SAVE_FILE_NAME, size, modified)) { return false; }
 
-    for (int i = 0; i < key.length(); i++)
+    uint64_t journalSize    = 0;
+    int64_t journalModified = 0;
+    if (MatcherImage::sourceStamp(JOURNAL_FILE_NAME, &journalSize, &journalModified))
     {
-      int index = key[i];
-      DEBUG("Looking for index %d", index);
-      if (!current->children[index]) { current->children[index] = getNode(); }
-
-      current = current->children[index];
+      *size += journalSize;
+      *modified = std::max(*modified, journalModified);
     }
-
-    current->terminal     = true;
-    current->abbreviation = abbreviation;
+    return true;
   }
 
-  // Because  we're doing partial matching as the user types on the keyboard,
-  // we need to check if possible matches are still "alive" even if they're not
-  // at a terminal leaf yet.
-  static bool containsPartial(TrieNode *root, char key)
+  // Startup without parsing anything. If the image compiled from the current save file and journal
+  // is still around we map it, publish it as the live snapshot as is, and fill the editor's rows
+  // straight from its string section. Returns false if there's no usable image, in which case the
+  // caller reads the save file as usual (which writes a fresh image once it's compiled).
+  bool loadImage()
   {
-    TrieNode *current = root;
-
-    if (!current->children[(int)key])
+    uint64_t size    = 0;
+    int64_t modified = 0;
+    if (!sourceStamp(&size, &modified)) { return false; }
+
+    MatcherSnapshot *snapshot = MatcherImage::load(IMAGE_FILE_NAME, size, modified);
+    if (snapshot == nullptr) { return false; }
+
+    entries.clear();
+    entries.reserve(snapshot->entryCount);
+    rowOfId.assign(snapshot->entryCount, -1);
+    terminalOfId.assign(snapshot->entryCount, nullptr);
+    for (int id = 0; id < snapshot->entryCount; id++)
     {
-      DEBUG("Value of %c not found.", key);
-      return false;
+      const SnapshotEntry &entry = snapshot->entries[id];
+      if (!(entry.flags & SNAPSHOT_ENTRY_LIVE)) { continue; }
+
+      uint8_t flags = 0;
+      if (entry.flags & SNAPSHOT_ENTRY_MULTILINE) { flags |= ENTRY_MULTILINE; }
+      if (entry.flags & SNAPSHOT_ENTRY_HIDDEN) { flags |= ENTRY_HIDDEN; }
+      if (entry.flags & SNAPSHOT_ENTRY_PASTE) { flags |= ENTRY_PASTE; }
+      rowOfId[id] = entries.add(id, snapshot->key(id), entry.keyLength, snapshot->expansion(id),
+                                entry.expansionLength, flags);
     }
 
-    DEBUG("Value of %c found.", key);
+    nodes.release();
+    root = TrieNode::getNode(nodes);
+
+    // An image holds no keystroke plans, so with a layout to type on it only stands in until the
+    // builder has planned them in the background
+    snapshot->pasteAbove = pasteAbove;
+    matcher.publish(snapshot);
+    matcherDirty = keyMap != nullptr;
+    DEBUG("Loaded %zu entries from %s", entries.size(), IMAGE_FILE_NAME);
+
+    // the image already has the journal's edits in it, we only need to know where to append
+    uint64_t journalSize = 0;
+    uint64_t checksum    = 0;
+    if (SaveFile::readChecksum(SAVE_FILE_NAME, &checksum) &&
+        Journal::replay(JOURNAL_FILE_NAME, checksum, nullptr, &journalSize) >= 0)
+    {
+      saver.resume(journalSize);
+    }
     return true;
   }
 
-  static bool contains(TrieNode *root, std::string key)
+  // Everything the keyboard hook does with a character once it has decided to look at it. Shared
+  // with the headless replayer so both go through exactly the same hook -> match -> expand path.
+  // Returns the id of the entry that got expanded, or -1.
+  int onKeyPress(char pressed, InjectionSink *sink)
   {
-
-    TrieNode *current = root;
-
-    for (int i = 0; i < key.length(); i++)
+    if (pressed == KEY_MODIFIER_PRESSED || pressed == KEY_SHIFT_RELEASED) { return -1; }
+
+    // the reader keeps the snapshot (and the expansion text inside it) alive until we're done sending
+    SnapshotReader reader(&matcher);
+    const MatcherSnapshot *snapshot = reader.snapshot;
+    int entry                       = snapshot->advance(cursor, pressed);
+    if (entry == -1) { return -1; }
+
+    const SnapshotEntry &match = snapshot->entries[entry];
+    std::shared_ptr<const std::string> body; // a lazy body, kept alive until it's been sent
+    const char *text = nullptr;
+    if (match.flags & SNAPSHOT_ENTRY_STORED)
     {
-      int index = key[i];
-      if (!current->children[index]) { return false; }
-
-      current = current->children[index];
+      body = snapshot->store->hot({match.expansionOffset, match.expansionLength});
+      text = body->c_str();
     }
+    else { text = snapshot->expansion(entry); }
+
+    size_t kept         = snapshot->kept(entry, text);
+    Injection injection = {(int)(match.keyLength - kept), text + kept, match.expansionLength - kept};
+    injection.paste     = snapshot->pastes(entry) && injection.length > 0;
+    injection.strokes   = snapshot->plan(entry, &injection.strokeCount);
+    if (injection.strokes != nullptr) { injection.layout = snapshot->keyMap->layout; }
+    sink->send(injection);
+    return entry;
+  }
 
-    return current->terminal;
+  // Resident size of the index the keyboard hook is matching against, for comparing engines.
+  size_t indexBytes()
+  {
+    SnapshotReader reader(&matcher);
+    return reader.snapshot->indexBytes();
   }
 
-  static TrieNode *getNode()
+  // Editing one entry only touches that entry's path through the trie. The Aho-Corasick links are
+  // global though, and the double array has no cheap way to insert into it, so both of those are
+  // compiled into a fresh snapshot once the user stops editing, see refreshMatcher().
+  void addEntry()
   {
-    TrieNode *node     = new TrieNode();
-    node->terminal     = false;
-    node->abbreviation = nullptr;
+    rowOfId.push_back(entries.add((int)rowOfId.size(), "", 0, "", 0, 0));
+    terminalOfId.push_back(nullptr);
+    journalUpsert((int)entries.size() - 1);
+    scheduleSave();
+  }
 
-    for (int i = 0; i < ALPHABET_SIZE; i++)
+  // Call after the abbreviation, expansion or flags of a row changed
+  void updateEntry(int row)
+  {
+    if (engine == ENGINE_TRIE)
     {
-      node->children[i] = nullptr;
+      detach(entries.ids[row]);
+      attach(entries.ids[row]);
     }
-
-    return node;
+    matcherDirty = true;
+    journalUpsert(row);
+    scheduleSave();
   }
-};
 
+  void deleteIndex(int index)
+  {
+    if (engine == ENGINE_TRIE) { detach(entries.ids[index]); }
+    rowOfId[entries.ids[index]] = -1;
 
-class AppData
-{
-public:
-  void init() { readSaveFile(); }
+    entries.erase(index);
+    for (int row = index; row < entries.size(); row++)
+    {
+      rowOfId[entries.ids[row]] = row;
+    }
+
+    matcherDirty = true;
+    journalOps.push_back({JOURNAL_DELETE, 0, (uint32_t)index, {}, {}});
+    scheduleSave();
+  }
 
-  Abbreviation *checkForCompletions()
+  // Typing into a field upserts the same row over and over, so consecutive upserts of one row
+  // collapse into a single op holding its latest text.
+  void journalUpsert(int row)
   {
-    DEBUG("Living Nodes Count: %d", livingNodes.size());
-    for (int i = (int)livingNodes.size() - 1; i >= 0; i--)
+    if (journalOps.empty() || journalOps.back().type != JOURNAL_UPSERT || journalOps.back().row != row)
     {
-      if (livingNodes[i]->terminal)
-      {
-        Abbreviation *result = livingNodes[i]->abbreviation;
-        std::swap(livingNodes[i], livingNodes[livingNodes.size() - 1]);
-        livingNodes.pop_back();
-        return result;
-      }
+      journalOps.push_back({JOURNAL_UPSERT, 0, (uint32_t)row, {}, {}});
     }
-    return nullptr;
+    JournalOp &op = journalOps.back();
+    op.flags      = entries.flags[row];
+    op.key.assign(entries.key(row), entries.keys[row].length);
+    op.expansion.assign(entries.expansion(row), entries.expansions[row].length);
+  }
+
+  void attach(int id)
+  {
+    TrieNode *node = TrieNode::insert(nodes, root, entries.key(rowOfId[id]));
+    terminalOfId[id] = node;
+    if (node == nullptr) { return; }
+
+    // duplicate keys go to whichever entry is further down the list, same as a full rebuild
+    if (!node->terminal || rowOfId[node->entry] < rowOfId[id]) { node->entry = id; }
+    node->terminal = true;
+    node->owners++;
   }
 
-  void advanceSearches(char c)
+  void detach(int id)
   {
-    for (int i = (int)livingNodes.size() - 1; i >= 0; i--)
+    TrieNode *node = terminalOfId[id];
+    terminalOfId[id] = nullptr;
+    if (node == nullptr) { return; }
+
+    node->owners--;
+    if (node->owners == 0) { node->terminal = false; }
+    else if (node->entry == id)
     {
-      if (TrieNode::containsPartial(livingNodes[i], c))
+      // rare: hand the key over to the last of the other entries that share it
+      node->entry = -1;
+      for (int other = 0; other < terminalOfId.size(); other++)
       {
-        // this one matches, continue advancing down the children
-        livingNodes[i] = livingNodes[i]->children[(int)c];
-      }
-      else
-      {
-        std::swap(livingNodes[i], livingNodes[livingNodes.size() - 1]);
-        livingNodes.pop_back();
+        if (terminalOfId[other] != node) { continue; }
+        if (node->entry == -1 || rowOfId[other] > rowOfId[node->entry]) { node->entry = other; }
       }
     }
 
-    if (TrieNode::containsPartial(root, c)) { livingNodes.push_back(root->children[(int)c]); }
-  }
-
-  void deleteIndex(int index)
-  {
-    entries.erase(entries.begin() + index);
-    saveToFile();
+    TrieNode::remove(nodes, root, node);
   }
 
   void readSaveFile()
   {
-    std::ifstream in;
-    in.open("./" SAVE_FILE_NAME);
-    if (!in)
+    SaveFileStatus status = SaveFile::read(SAVE_FILE_NAME, &entries, lazyBodies);
+    if (status == SAVE_FILE_OLDER_FORMAT) { status = updateSaveFileFormat(); }
+    if (status == SAVE_FILE_MISSING)
     {
       ERR("Failed to open the config in %s", SAVE_FILE_NAME);
       resetEntries();
       return;
     }
+    if (status == SAVE_FILE_CORRUPT)
+    {
+      ERR("Keeping the damaged config as %s.backup and loading a clean slate.", SAVE_FILE_NAME);
+      backupConfigFile();
+      resetEntries();
+      return;
+    }
 
-    std::string line;
-    std::string label;
-    std::string value;
-    getline(in >> std::ws, line, DELIMITER);
-    if (line != "ABBRV_SAVE_FILE_VERSION:" ABBRV_SAVE_FILE_VERSION) { updateSaveFileFormat(); }
-
-    int savedEntriesCount = 0;
-    getline(in >> std::ws, line, DELIMITER);
-    GET_LABEL_AND_VALUE;
-    savedEntriesCount = atoi(value.c_str());
-
-    for (int i = 0; i < savedEntriesCount; i++)
+    // Whatever was edited since the save file was last written. Normally the journal is folded
+    // back in on exit, so finding ops here means we didn't get to exit cleanly.
+    uint64_t checksum    = 0;
+    uint64_t journalSize = 0;
+    int replayed         = -1;
+    if (SaveFile::readChecksum(SAVE_FILE_NAME, &checksum))
     {
-      DEBUG("LOOP");
-      entries.push_back({});
-      while (line != "}")
-      {
-        getline(in >> std::ws, line, DELIMITER);
-        DEBUG("Reading line [%s]", line.c_str());
-        GET_LABEL_AND_VALUE;
-        DEBUG("Read label [%s] with value [%s]", label.c_str(), value.c_str());
-        if (0) {}
-        READ(entries[i].isHiddenField)
-        READ(entries[i].isMultiline)
-        READ_CHAR_ARRAY(entries[i].abbreviation)
-        READ_CHAR_ARRAY(entries[i].expandsTo)
-      }
-      getline(in >> std::ws, line, DELIMITER);
+      replayed = Journal::replay(JOURNAL_FILE_NAME, checksum, &entries, &journalSize);
     }
+    if (replayed > 0) { WARN("Recovered %d unsaved edits from %s", replayed, JOURNAL_FILE_NAME); }
 
     resetEntries();
+
+    // Row numbers in a journal only make sense on top of the exact save file it was started on,
+    // so a replayed one gets compacted before anything new is appended
+    if (replayed > 0) { saver.compact(new EntryTable(entries), revision); }
+    else if (replayed == 0) { saver.resume(journalSize); }
+  }
+
+  // Writes the entries out in the old text format, for reading or diffing by hand
+  bool exportText(const char *path)
+  {
+    if (!SaveFile::writeText(entries, path)) { return false; }
+    DEBUG("Exported %zu entries to %s", entries.size(), path);
+    return true;
+  }
+
+  // Merges a CSV, TSV or JSON file into the dictionary, see BulkIO::read. However many rows it
+  // has, that's one full save and one rebuild of the index at the end, rather than a journal op
+  // and a trie insert per row. The rebuild happens in the background like after any other edit,
+  // the hook matches against the old snapshot until it lands.
+  bool importFile(const char *path, BulkFormat format, BulkStats *stats)
+  {
+    if (!BulkIO::read(path, format, &entries, stats)) { return false; }
+
+    // the compaction already holds any edits that were waiting on a save
+    revision++;
+    journalOps.clear();
+    unsavedEdits = 0;
+    saver.compact(new EntryTable(entries), revision);
+    renumberEntries();
+    matcherDirty = true;
+    return true;
+  }
+
+  bool exportFile(const char *path, BulkFormat format, BulkStats *stats)
+  {
+    return BulkIO::write(entries, path, format, stats);
   }
 
   void backupConfigFile()
@@ -211,121 +329,306 @@ public:
     dst << src.rdbuf();
   }
 
-  void updateSaveFileFormat()
+  // Rewrites a text save file, either ABBRV_SAVE_1_0 or the unversioned format from before it,
+  // as the current binary one and loads that. The original is kept as a backup. If the new file
+  // can't be written the text gets loaded as it is, and the first save converts it instead.
+  SaveFileStatus updateSaveFileFormat()
   {
     WARN("Updating to the new Save File Format");
     backupConfigFile();
-    std::ifstream in;
-    in.open("./" SAVE_FILE_NAME);
-    if (!in)
+    if (SaveFile::migrate(SAVE_FILE_NAME, migrationProgress))
     {
-      ERR("Failed to open the config in %s", SAVE_FILE_NAME);
-      resetEntries();
-      return;
+      return SaveFile::read(SAVE_FILE_NAME, &entries, lazyBodies);
     }
+    return SaveFile::readText(SAVE_FILE_NAME, &entries) ? SAVE_FILE_LOADED : SAVE_FILE_CORRUPT;
+  }
 
-    std::string abbreviation;
-    std::string expandsTo;
-    bool isMultiline   = false;
-    bool isHiddenField = false;
+  static void reportMigration(size_t done, size_t total)
+  {
+    WARN("Updating the save file, %d%% done", (int)(100.0 * done / (total > 0 ? total : 1)));
+  }
 
-    int abortCounter = 0;
-    int abortLimit   = 10000;
-    while (!in.eof())
+  // Throws away the old index in one go and builds a new one, before anything can be matched.
+  void resetEntries()
+  {
+    renumberEntries();
+    compileMatcher();
+  }
+
+  // Gives every row its own row number as id and rebuilds the editor's trie to match, leaving the
+  // snapshot to whoever calls it. The trie can never have more nodes than there are key characters,
+  // so reserving that many up front makes the rebuild a single allocation and keeps the nodes next
+  // to each other in memory.
+  void renumberEntries()
+  {
+    size_t keyCharacters = 0;
+    if (engine == ENGINE_TRIE)
     {
-      in >> isMultiline;
-      // in >> std::ws -- removes any whitespace from the line before processing
-      std::getline(in >> std::ws, abbreviation, DELIMITER);
-      DEBUG("Abbreviation: [%s]", abbreviation.c_str());
-      std::getline(in, expandsTo, DELIMITER);
-      if (abbreviation != "")
+      for (int i = 0; i < entries.size(); i++)
       {
-        Abbreviation toAdd;
-        toAdd.isMultiline   = isMultiline;
-        toAdd.isHiddenField = isHiddenField;
-        strcpy(toAdd.abbreviation, abbreviation.c_str());
-        strcpy(toAdd.expandsTo, expandsTo.c_str());
-        entries.push_back(toAdd);
+        keyCharacters += entries.keys[i].length;
       }
+    }
+    nodes.release();
+    nodes.reserve(keyCharacters + 1);
+    root = TrieNode::getNode(nodes);
 
-      abortCounter++;
-      if (abortCounter > abortLimit)
-      {
-        ERR("Failure to parse and update Save File. Aborting update and loading clean slate.");
-        entries = {};
-        return;
-      }
+    rowOfId.resize(entries.size());
+    terminalOfId.assign(entries.size(), nullptr);
+    for (int i = 0; i < entries.size(); i++)
+    {
+      entries.ids[i] = i;
+      rowOfId[i]     = i;
+      if (engine == ENGINE_TRIE) { attach(i); }
     }
-    in.close();
+  }
 
-    resetEntries();
+  // Copies what the snapshot needs out of entries. This is the only part of a rebuild that has to
+  // happen on the thread that owns entries, everything else is done by MatcherSnapshot::compile().
+  MatcherSnapshot *prepareSnapshot()
+  {
+    MatcherSnapshot *snapshot = new MatcherSnapshot();
+    snapshot->engine          = engine;
+    snapshot->store           = entries.store;
+    snapshot->keyMap          = keyMap;
+    snapshot->pasteAbove      = pasteAbove;
+    for (int i = 0; i < entries.size(); i++)
+    {
+      uint32_t flags = 0;
+      if (entries.is(i, ENTRY_MULTILINE)) { flags |= SNAPSHOT_ENTRY_MULTILINE; }
+      if (entries.is(i, ENTRY_HIDDEN)) { flags |= SNAPSHOT_ENTRY_HIDDEN; }
+      if (entries.is(i, ENTRY_PASTE)) { flags |= SNAPSHOT_ENTRY_PASTE; }
+      if (entries.stored[i]) { snapshot->addStoredEntry(entries.ids[i], entries.key(i), entries.expansions[i], flags); }
+      else { snapshot->addEntry(entries.ids[i], entries.key(i), entries.expansion(i), flags); }
+    }
+
+    // The image has to be stamped with files on disk holding exactly these entries. If the writer
+    // hasn't caught up yet we skip it here, and persist() asks for another rebuild once it has.
+    snapshot->revision = revision;
+    if (usesImage() && saver.saved() == revision)
+    {
+      imageWrites = saver.writes();
+      if (sourceStamp(&snapshot->sourceSize, &snapshot->sourceModified)) { snapshot->imagePath = IMAGE_FILE_NAME; }
+    }
 
+    if (engine == ENGINE_TRIE)
+    {
+      snapshot->nodes.reserve(nodes.size());
+      snapshot->root = TrieNode::clone(snapshot->nodes, root, nullptr);
+    }
+    return snapshot;
+  }
 
-    std::ofstream out;
-    out.open("./" SAVE_FILE_NAME);
-    if (!out)
+  // Synchronous rebuild, for when we can't match anything until it's done (i.e. startup).
+  void compileMatcher()
+  {
+    MatcherSnapshot *snapshot = prepareSnapshot();
+    snapshot->compile();
+    matcher.publish(snapshot);
+    matcherDirty = false;
+  }
+
+  // Hands any pending changes to the background builder. Called once a frame while the editor
+  // isn't being typed into; the hook keeps using the previous snapshot until the new one lands.
+  void refreshMatcher()
+  {
+    if (matcherDirty)
     {
-      ERR("Failed to open the config file %s", SAVE_FILE_NAME);
-      return;
+      builder.submit(prepareSnapshot());
+      matcherDirty = false;
     }
-    WRITE(ABBRV_SAVE_FILE_VERSION);
-    WRITE(entries.size());
+    matcher.reclaim();
+  }
 
-    for (int i = 0; i < entries.size(); i++)
+  // Picks up a save file replaced from outside, by a sync tool say. Called once a frame while the
+  // editor isn't being typed into. Only looked at once our own saves have caught up, so the file
+  // on disk is either the one we last wrote or someone else's, and theirs wins over what we have.
+  // The file is read and diffed on the reloader's thread; edits made in the meantime send it back
+  // for another go.
+  void watchSaveFile()
+  {
+    if (watcher.changed()) { reloadWanted = true; }
+
+    ConfigReload *reload = reloader.take();
+    if (reload != nullptr)
     {
-      START_WRITE("{");
-      WRITE(entries[i].isHiddenField);
-      WRITE(entries[i].isMultiline);
-      WRITE(entries[i].abbreviation);
-      WRITE(entries[i].expandsTo);
-      END_WRITE("}");
+      if (reload->status != SAVE_FILE_LOADED) { WARN("Couldn't reload %s, keeping what we have", SAVE_FILE_NAME); }
+      else if (reload->revision != revision) { reloadWanted = true; }
+      else { applyReload(reload); }
+      delete reload;
     }
 
-    DEBUG("Saved our entries.");
-    resetEntries();
+    bool caughtUp = unsavedEdits == 0 && saver.saved() == revision;
+    if (!reloadWanted || !caughtUp || reloader.busy()) { return; }
+    reloadWanted = false;
+
+    uint64_t size    = 0;
+    int64_t modified = 0;
+    if (!MatcherImage::sourceStamp(SAVE_FILE_NAME, &size, &modified)) { return; }
+    if ((size == loadedSize && modified == loadedModified) || saver.wrote(size, modified)) { return; }
+    reloader.submit(new EntryTable(entries), revision, lazyBodies);
   }
 
-  void resetEntries()
+  // Swaps in the reloaded entries. Rows that kept their abbreviation keep their id, so the trie
+  // only loses the removed keys and gains the added ones, and the other engines recompile in the
+  // background like after any edit. The hook matches against the old snapshot until then.
+  void applyReload(ConfigReload *reload)
   {
-    livingNodes = {};
-    root        = nullptr;
-    root        = TrieNode::getNode();
-    for (int i = 0; i < entries.size(); i++)
+    for (int id : reload->removed)
     {
-      TrieNode::insert(root, entries[i].abbreviation, &entries[i]);
+      if (engine == ENGINE_TRIE) { detach(id); }
+      rowOfId[id] = -1;
     }
+
+    entries = std::move(reload->entries);
+    std::vector<int> added;
+    for (int row = 0; row < entries.size(); row++)
+    {
+      if (entries.ids[row] == -1)
+      {
+        entries.ids[row] = (int)rowOfId.size();
+        rowOfId.push_back(row);
+        terminalOfId.push_back(nullptr);
+        added.push_back(entries.ids[row]);
+      }
+      else { rowOfId[entries.ids[row]] = row; }
+    }
+
+    if (engine == ENGINE_TRIE)
+    {
+      for (int id : added)
+      {
+        attach(id);
+      }
+
+      // which of several rows with the same key fires depends on their order
+      for (int row = 0; reload->reordered && row < entries.size(); row++)
+      {
+        TrieNode *node = terminalOfId[entries.ids[row]];
+        if (node == nullptr || node->owners < 2) { continue; }
+        detach(entries.ids[row]);
+        attach(entries.ids[row]);
+      }
+    }
+
+    WARN("Reloaded %s: %zu added, %zu changed, %zu removed", SAVE_FILE_NAME, reload->added, reload->changed,
+         reload->removed.size());
+    loadedSize     = reload->size;
+    loadedModified = reload->modified;
+    revision++;
+    saver.rebase(reload->size, reload->modified, reload->checksum, revision);
+    if (reload->differs()) { matcherDirty = true; }
   }
 
-  void saveToFile()
+  // Folds everything, including edits that haven't been saved at all yet, into a fresh save file
+  // before we return. People copy config.abbrv between machines on its own (see the FAQ), so it
+  // shouldn't depend on a journal next to it.
+  void shutdown()
   {
-    std::ofstream out;
-    out.open("./" SAVE_FILE_NAME);
-    if (!out)
+    bool compacting = unsavedEdits > 0 || saver.saved() != revision || saver.journalBytes() > sizeof(JournalHeader);
+    if (compacting)
     {
-      ERR("Failed to open the config file %s", SAVE_FILE_NAME);
-      return;
+      saver.compact(new EntryTable(entries), revision);
+      journalOps.clear();
+      unsavedEdits = 0;
     }
+    saver.stop();
+    builder.stop();
+    reloader.stop();
+    watcher.stop();
+
+    // Saves the next startup a parse. Only if the live snapshot already matches the new save file,
+    // there's no time for a rebuild now.
+    uint64_t size    = 0;
+    int64_t modified = 0;
+    SnapshotReader reader(&matcher);
+    if (compacting && usesImage() && reader.snapshot->revision == revision &&
+        saver.saved() == revision && sourceStamp(&size, &modified))
+    {
+      MatcherImage::write(*reader.snapshot, IMAGE_FILE_NAME, size, modified);
+    }
+  }
 
-    WRITE(ABBRV_SAVE_FILE_VERSION);
-    WRITE(entries.size());
+  // Edits only queue up journal ops, the disk is left to persist() and the writer thread
+  void scheduleSave()
+  {
+    revision++;
+    unsavedEdits++;
+    lastEdit = std::chrono::steady_clock::now();
+  }
 
-    for (int i = 0; i < entries.size(); i++)
+  // Called once a frame. Hands the queued ops to the writer once the editor has gone quiet or
+  // enough edits have piled up, so a save costs about as much as what changed. The formatting and
+  // the disk I/O all happen on the writer's thread.
+  void persist()
+  {
+    if (unsavedEdits > 0)
     {
-      START_WRITE("{");
-      WRITE(entries[i].isHiddenField);
-      WRITE(entries[i].isMultiline);
-      WRITE(entries[i].abbreviation);
-      WRITE(entries[i].expandsTo);
-      END_WRITE("}");
+      std::chrono::steady_clock::duration quiet = std::chrono::steady_clock::now() - lastEdit;
+      if (unsavedEdits >= SAVE_MAX_PENDING_EDITS || quiet >= std::chrono::milliseconds(SAVE_QUIET_PERIOD_MS))
+      {
+        submitSave();
+      }
     }
 
-    DEBUG("Saved our entries.");
-    resetEntries();
+    // the files on disk changed since the live snapshot was compiled, so its image is stale
+    bool caughtUp = unsavedEdits == 0 && saver.saved() == revision;
+    if (usesImage() && caughtUp && imageWrites != saver.writes()) { matcherDirty = true; }
+  }
+
+  // Until there is a journal on top of the current save file (first save, or a write failed) and
+  // once it has grown past JOURNAL_COMPACT_BYTES, the whole dictionary is written out instead.
+  void submitSave()
+  {
+    if (!saver.journaling() || saver.journalBytes() > JOURNAL_COMPACT_BYTES)
+    {
+      saver.compact(new EntryTable(entries), revision);
+    }
+    else { saver.append(std::move(journalOps), revision); }
+    journalOps.clear(); // moved out, or part of the compaction
+    unsavedEdits = 0;
   }
 
+  MatcherEngine engine = ENGINE_DOUBLE_ARRAY;
+  bool lazyBodies      = false; // leave expansions in the save file until they're needed, see ExpansionStore
+
+  // The editor side of the index. Only kept up to date for the trie engine, where it is cloned
+  // into each snapshot instead of reinserting every key.
+  Arena<TrieNode> nodes;
   TrieNode *root;
-  std::vector<Abbreviation> entries;
-  std::vector<TrieNode *> livingNodes;
+
+  // The keyboard hook only ever touches these
+  SnapshotSlot matcher;
+  MatchCursor cursor;
+
+  // Layout expansions get typed on, set by whoever does the typing (Platform::currentKeyMap()).
+  // Snapshots plan keystrokes for it, so swapping it in needs matcherDirty set.
+  std::shared_ptr<const KeyMap> keyMap;
+
+  // Expansions longer than this many characters get pasted instead of typed, along with any entry
+  // marked ENTRY_PASTE. 0 leaves it to the entries.
+  size_t pasteAbove = PASTE_ABOVE_CHARACTERS;
+
+  MatcherBuilder builder{&matcher};
+  bool matcherDirty = false;
+
+  SaveWriter saver{SAVE_FILE_NAME, JOURNAL_FILE_NAME};
+  MigrationProgress migrationProgress = reportMigration; // swap before init() to show a long migration elsewhere
+  FileWatcher watcher;
+  ConfigReloader reloader{SAVE_FILE_NAME};
+  bool reloadWanted      = false; // the save file changed, look at it once we're caught up
+  uint64_t loadedSize    = 0;     // stamp of the save file entries were read from
+  int64_t loadedModified = 0;
+
+  std::vector<JournalOp> journalOps; // made since the last save, in order
+  uint64_t revision    = 0;          // bumped by every edit, files on disk and snapshots know which one they hold
+  uint64_t imageWrites = 0;          // SaveWriter::writes() when the live snapshot's image was stamped
+  int unsavedEdits     = 0;
+  std::chrono::steady_clock::time_point lastEdit;
+
+  EntryTable entries;
+  std::vector<int> rowOfId;              // where each entry id currently sits in entries, -1 once deleted
+  std::vector<TrieNode *> terminalOfId;  // node each entry id's key ends at
 };
 
 #endif
@@ -0,0 +1,114 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <stddef.h>
+
+#include <vector>
+
+// Hands out T's from a handful of large blocks instead of one heap allocation per object, and
+// frees all of them at once. Individual objects can be handed back with free() and get reused.
+// Objects are never constructed or destructed by the arena, so this is only meant for plain
+// structs that get initialized by whoever allocates them (see TrieNode::getNode).
+template <typename T>
+class Arena
+{
+public:
+  Arena() {}
+  ~Arena() { release(); }
+
+  Arena(const Arena &)            = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // Guarantees the next `count` allocations come out of a single contiguous block. Used when
+  // we know roughly how many objects a rebuild will need so the whole thing is one allocation.
+  void reserve(size_t count)
+  {
+    if (!blocks.empty() && blocks.back().size - blocks.back().used >= count) { return; }
+    addBlock(count);
+  }
+
+  T *allocate()
+  {
+    live++;
+    if (!freed.empty())
+    {
+      T *item = freed.back();
+      freed.pop_back();
+      return item;
+    }
+
+    if (blocks.empty() || blocks.back().used == blocks.back().size)
+    {
+      // grow geometrically so a long series of inserts stays at a few blocks
+      addBlock(blocks.empty() ? MIN_BLOCK_SIZE : blocks.back().size * 2);
+    }
+
+    Block &block = blocks.back();
+    return &block.items[block.used++];
+  }
+
+  // Hands a single object back for reuse by a later allocate(). The memory itself only goes back
+  // to the system on release().
+  void free(T *item)
+  {
+    live--;
+    freed.push_back(item);
+  }
+
+  void release()
+  {
+    for (int i = 0; i < blocks.size(); i++)
+    {
+      delete[] blocks[i].items;
+    }
+    blocks.clear();
+    freed.clear();
+    live = 0;
+  }
+
+  // objects currently handed out
+  size_t size() const { return live; }
+
+  size_t bytes() const
+  {
+    size_t total = 0;
+    for (int i = 0; i < blocks.size(); i++)
+    {
+      total += blocks[i].size * sizeof(T);
+    }
+    return total;
+  }
+
+private:
+  inline static const size_t MIN_BLOCK_SIZE = 64;
+
+  struct Block
+  {
+    T *items;
+    size_t used;
+    size_t size;
+  };
+
+  void addBlock(size_t size) { blocks.push_back({new T[size], 0, size}); }
+
+  std::vector<Block> blocks;
+  std::vector<T *> freed;
+  size_t live = 0;
+};
+
+#endif
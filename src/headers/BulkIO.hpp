@@ -0,0 +1,81 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef BULK_IO_HPP
+#define BULK_IO_HPP
+
+// Imports are cut into chunks of about this size, each parsed on its own by a worker
+#define BULK_CHUNK_BYTES (1024 * 1024)
+
+// Chunks parsed per worker ahead of the one being merged, which bounds the memory an import holds
+// on top of the dictionary however big the file is
+#define BULK_CHUNKS_AHEAD 4
+
+#include <stddef.h>
+
+#include <string>
+
+#include "EntryTable.hpp"
+
+enum BulkFormat
+{
+  BULK_UNKNOWN,
+  BULK_CSV,  // RFC 4180: quoted fields, "" for a quote inside one, fields may span lines
+  BULK_TSV,  // one row per line, \t \n \r and \\ escaped inside fields
+  BULK_JSON, // an array of {"abbreviation": ..., "expansion": ..., "multiline": ..., "hidden": ..., "paste": ...}
+};
+
+struct BulkStats
+{
+  size_t rows       = 0; // read from the file, or written to it
+  size_t added      = 0; // keys the dictionary didn't have yet
+  size_t updated    = 0; // existing rows that got a new expansion or flags
+  size_t unchanged  = 0; // existing rows the file agreed with
+  size_t duplicates = 0; // rows whose key came up earlier in the same file, the last one wins
+  size_t skipped    = 0; // rows without an abbreviation or too few columns to make sense of
+  size_t errorLine  = 0; // where a JSON import stopped making sense, 0 if it didn't
+  double seconds    = 0;
+
+  double rowsPerSecond() const { return seconds > 0 ? rows / seconds : 0; }
+};
+
+// Moves a whole dictionary in or out of the formats spreadsheets and scripts deal in. Columns are
+// abbreviation, expansion, multiline, hidden, paste, in that order unless the first row is a header
+// naming them. Without a multiline column, expansions with a line break in them are multiline.
+class BulkIO
+{
+public:
+  // By extension, .csv .tsv .tab or .json
+  static BulkFormat formatOf(const char *path);
+  static bool parseFormat(const char *name, BulkFormat *format);
+  static const char *formatName(BulkFormat format);
+
+  // Merges the rows in `path` into entries. A key the dictionary already has replaces the
+  // expansion and flags of the last row with that key, same one the matcher fires; anything else
+  // is appended with an id of -1, so the ids need reassigning afterwards (AppData::renumberEntries).
+  //
+  // The file is mapped and cut into chunks at row boundaries. Workers parse the chunks in
+  // parallel while this thread merges them in file order, so the result is the same as reading it
+  // front to back. Nothing changes unless the whole file was read.
+  static bool read(const char *path, BulkFormat format, EntryTable *entries, BulkStats *stats);
+
+  // Streams every row out with a header, replacing whatever was at `path`
+  static bool write(const EntryTable &entries, const char *path, BulkFormat format, BulkStats *stats);
+
+  // Appends text as a quoted JSON string, escaping quotes, backslashes and control characters
+  static void appendJsonString(std::string &out, const char *text, size_t length);
+};
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CHECKSUM_SEED  14695981039346656037ULL
+#define CHECKSUM_PRIME 1099511628211ULL
+
+// FNV-1a taken a 64 bit word at a time, with whatever doesn't fill a word at the end folded in a
+// byte at a time. A byte at a time was over half the cost of loading a save file. Every step is
+// still a bijection, so changing any one word always changes the result. Feeding it in pieces gives
+// the same answer as all at once as long as every piece but the last is a whole number of words.
+inline uint64_t checksum(uint64_t hash, const void *data, size_t size)
+{
+  const char *bytes = (const char *)data;
+  size_t i          = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+  {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash ^= word;
+    hash *= CHECKSUM_PRIME;
+  }
+  for (; i < size; i++)
+  {
+    hash ^= (unsigned char)bytes[i];
+    hash *= CHECKSUM_PRIME;
+  }
+  return hash;
+}
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef CONFIG_RELOAD_HPP
+#define CONFIG_RELOAD_HPP
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "EntryTable.hpp"
+#include "SaveFile.hpp"
+
+// A save file someone else wrote, read and lined up against the entries we had when it was noticed.
+// Rows are matched by key, the n-th row with a key in the file to the n-th row with that key in
+// ours, so an entry keeps its id across the reload for as long as it keeps its abbreviation.
+struct ConfigReload
+{
+  SaveFileStatus status = SAVE_FILE_MISSING;
+  EntryTable entries;    // the file in its own order, ids set to the matching id of ours or -1
+  uint64_t revision = 0; // of the entries it was diffed against
+  uint64_t size     = 0; // stamp of the file that was read, see MatcherImage::sourceStamp()
+  int64_t modified  = 0;
+  uint64_t checksum = 0; // see SaveFile::readChecksum(), 0 for a text file
+  std::vector<int> removed; // ids of ours the file doesn't have anymore
+  size_t added   = 0;
+  size_t changed = 0; // matched, but with a different expansion or flags
+  bool reordered = false;
+
+  bool differs() const { return added > 0 || changed > 0 || !removed.empty() || reordered; }
+
+  // Reads `path` and diffs it against `current`, the entries as of `revision`
+  static ConfigReload *load(const char *path, bool lazy, const EntryTable &current, uint64_t revision);
+};
+
+// Background thread doing ConfigReload::load(), so reading even a large save file never holds up
+// the thread the keyboard hook runs on. One reload at a time; the editor takes the result and
+// applies it once it's done, see AppData::applyReload().
+class ConfigReloader
+{
+public:
+  ConfigReloader(const char *path) : path(path) {}
+  ~ConfigReloader() { stop(); }
+
+  // Takes ownership of `current`, a copy of the entries as of `revision`
+  void submit(EntryTable *current, uint64_t revision, bool lazy)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!thread.joinable()) { thread = std::thread(&ConfigReloader::run, this); }
+      delete pending;
+      pending     = current;
+      pendingAt   = revision;
+      pendingLazy = lazy;
+      working     = true;
+    }
+    wake.notify_one();
+  }
+
+  // The finished reload, owned by the caller from here on, or null if there isn't one yet
+  ConfigReload *take()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ConfigReload *reload = finished;
+    finished             = nullptr;
+    if (reload != nullptr) { working = false; }
+    return reload;
+  }
+
+  // Submitted and not taken yet
+  bool busy()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return working;
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    if (thread.joinable()) { thread.join(); }
+
+    delete pending;
+    delete finished;
+    pending  = nullptr;
+    finished = nullptr;
+    working  = false;
+    stopping = false;
+  }
+
+private:
+  void run()
+  {
+    while (true)
+    {
+      EntryTable *current = nullptr;
+      uint64_t revision   = 0;
+      bool lazy           = false;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || pending != nullptr; });
+        if (stopping) { return; }
+        current  = pending;
+        revision = pendingAt;
+        lazy     = pendingLazy;
+        pending  = nullptr;
+      }
+
+      ConfigReload *reload = ConfigReload::load(path, lazy, *current, revision);
+      delete current;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        delete finished;
+        finished = reload;
+      }
+    }
+  }
+
+  const char *path;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  EntryTable *pending    = nullptr;
+  uint64_t pendingAt     = 0;
+  bool pendingLazy       = false;
+  ConfigReload *finished = nullptr;
+  bool working           = false;
+  bool stopping          = false;
+};
+
+#endif
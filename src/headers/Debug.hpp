@@ -54,11 +54,12 @@ class Debug
 {
 public:
   static void init();
-  static void error(const char* file, int line, std::string format, ...);
-  static void log(const char* file, int line, std::string format, ...);
-  static void warn(const char* file, int line, std::string format, ...);
+  static void error(const char* file, int line, const char* format, ...);
+  static void log(const char* file, int line, const char* format, ...);
+  static void warn(const char* file, int line, const char* format, ...);
 
   static FILE* file;
+  static FILE* output; // stdout unless a tool needs stdout for its own output
   static std::string lastLine;
   static int timesRepeated;
 };
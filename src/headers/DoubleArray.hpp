@@ -0,0 +1,327 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef DOUBLE_ARRAY_HPP
+#define DOUBLE_ARRAY_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Debug.hpp"
+
+// A compact alternative to TrieNode's 128 child pointers per node. Every state lives in one slot of
+// a few parallel int32 arrays. Taking character c from state s lands in slot base[s] + c, and that
+// slot only belongs to s if check[slot] == s. On top of the goto function we keep the same
+// Aho-Corasick fail / output links as the pointer trie so matching behaves identically.
+struct DoubleArrayTrie
+{
+  inline static const int32_t ROOT     = 0;
+  inline static const int32_t EMPTY    = -1; // check value of a slot no state owns
+  inline static const int32_t NO_MATCH = -1; // output value of a state where no abbreviation ends
+  inline static const int LABEL_COUNT  = 128;
+
+  // The four arrays are views so they can point either into storage or straight into a mapped
+  // image file (see MatcherImage). Nothing in them is a pointer, so they work at any address.
+  const int32_t *base   = nullptr;
+  const int32_t *check  = nullptr;
+  const int32_t *fail   = nullptr;
+  const int32_t *output = nullptr; // entry index of the longest abbreviation ending in this state
+  int32_t size          = 0;
+  int32_t keyCount      = 0;
+
+  std::vector<int32_t> storage; // base, check, fail and output back to back, unless mapped
+
+  int32_t next(int32_t state, int c) const
+  {
+    while (true)
+    {
+      int32_t slot = base[state] + c;
+      if (slot < size && check[slot] == state) { return slot; }
+      if (state == ROOT) { return ROOT; }
+      state = fail[state];
+    }
+  }
+
+  size_t bytes() const { return (size_t)size * 4 * sizeof(int32_t); }
+
+  // Points the views at an external block laid out like storage
+  void view(const int32_t *arrays, int32_t slots)
+  {
+    size   = slots;
+    base   = arrays;
+    check  = arrays + slots;
+    fail   = arrays + 2 * (size_t)slots;
+    output = arrays + 3 * (size_t)slots;
+  }
+
+  // keys[i] belongs to entry i, and rows lists the entries in the editor's row order. Empty keys and
+  // keys with non-ASCII characters are skipped, and when two entries share a key the one further
+  // down the rows wins, same as in the pointer trie. Ids are only in row order until a reload moves rows.
+  void build(const std::vector<const char *> &keys, const std::vector<int32_t> &rows)
+  {
+    Builder builder(this);
+    builder.run(keys, rows);
+  }
+
+private:
+  // Build-only bookkeeping, thrown away once the arrays are finished.
+  struct Builder
+  {
+    struct Range
+    {
+      int32_t state;
+      int32_t lo;
+      int32_t hi;
+      int depth;
+    };
+
+    DoubleArrayTrie *trie;
+    std::vector<int32_t> base;
+    std::vector<int32_t> check;
+    std::vector<const char *> keys;
+    std::vector<int32_t> order;      // entry indices sorted by key
+    std::vector<int32_t> value;      // entry index that ends exactly at a state
+    std::vector<int32_t> nextFree;   // doubly linked list of unused slots
+    std::vector<int32_t> prevFree;
+    std::vector<int32_t> childStart; // offset of a state's labels in the labels list
+    std::vector<uint8_t> childCount;
+    std::vector<uint8_t> labels;
+    std::vector<Range> pending;      // ranges still waiting for insertRange
+    uint8_t childLabels[LABEL_COUNT]    = {}; // insertRange scratch, kept here to stay off the stack
+    int32_t groupStart[LABEL_COUNT + 1] = {};
+    int32_t freeHead = EMPTY;
+    int32_t freeTail = EMPTY;
+
+    Builder(DoubleArrayTrie *trie) : trie(trie) {}
+
+    void run(const std::vector<const char *> &input, const std::vector<int32_t> &rows)
+    {
+      keys = input;
+      for (int32_t i : rows)
+      {
+        if (keys[i] == nullptr || keys[i][0] == '\0') { continue; }
+        if (!isAscii(keys[i]))
+        {
+          WARN("Skipping %s, it contains a non-ASCII character", keys[i]);
+          continue;
+        }
+        order.push_back(i);
+      }
+
+      // stable, so entries sharing a key stay in row order and the last of them ends up in value
+      std::stable_sort(order.begin(), order.end(),
+                       [this](int32_t a, int32_t b) { return strcmp(keys[a], keys[b]) < 0; });
+
+      trie->keyCount = 0;
+
+      grow(LABEL_COUNT * 2);
+      claim(ROOT);
+
+      if (!order.empty()) { insertAll(); }
+      for (int32_t i = 1; i < (int32_t)order.size(); i++)
+      {
+        if (strcmp(keys[order[i - 1]], keys[order[i]]) != 0) { trie->keyCount++; }
+      }
+      if (!order.empty()) { trie->keyCount++; }
+
+      // anything still on the free list is padding, make sure no state can claim it
+      for (int32_t slot = freeHead; slot != EMPTY; slot = nextFree[slot])
+      {
+        check[slot] = EMPTY;
+      }
+
+      // the goto function is done, pack everything into its final home and add the links
+      int32_t slots = (int32_t)base.size();
+      trie->storage.assign((size_t)slots * 4, 0);
+      std::copy(base.begin(), base.end(), trie->storage.begin());
+      std::copy(check.begin(), check.end(), trie->storage.begin() + slots);
+      trie->view(trie->storage.data(), slots);
+
+      buildLinks();
+    }
+
+    static bool isAscii(const char *key)
+    {
+      for (const char *c = key; *c; c++)
+      {
+        if ((unsigned char)*c >= LABEL_COUNT) { return false; }
+      }
+      return true;
+    }
+
+    void grow(int32_t size)
+    {
+      int32_t oldSize = (int32_t)base.size();
+      if (size <= oldSize) { return; }
+
+      base.resize(size, 0);
+      check.resize(size, EMPTY);
+      value.resize(size, NO_MATCH);
+      nextFree.resize(size, EMPTY);
+      prevFree.resize(size, EMPTY);
+      childStart.resize(size, 0);
+      childCount.resize(size, 0);
+
+      // append the new slots to the back of the free list, keeping it in ascending order
+      for (int32_t slot = oldSize; slot < size; slot++)
+      {
+        prevFree[slot] = freeTail;
+        if (freeTail == EMPTY) { freeHead = slot; }
+        else { nextFree[freeTail] = slot; }
+        freeTail = slot;
+      }
+    }
+
+    void claim(int32_t slot)
+    {
+      if (prevFree[slot] == EMPTY) { freeHead = nextFree[slot]; }
+      else { nextFree[prevFree[slot]] = nextFree[slot]; }
+      if (nextFree[slot] == EMPTY) { freeTail = prevFree[slot]; }
+      else { prevFree[nextFree[slot]] = prevFree[slot]; }
+      nextFree[slot] = prevFree[slot] = EMPTY;
+    }
+
+    bool isFree(int32_t slot)
+    {
+      return slot != ROOT && slot < (int32_t)check.size() && check[slot] == EMPTY;
+    }
+
+    // Walk the free list until every label fits. Slots past the end of the arrays are always free.
+    int32_t findBase(const uint8_t *childLabels, int count)
+    {
+      int32_t slot = freeHead;
+      while (true)
+      {
+        if (slot == EMPTY)
+        {
+          slot = (int32_t)base.size();
+          grow(slot * 2);
+          continue;
+        }
+
+        int32_t candidate = slot - childLabels[0];
+        if (candidate >= 0)
+        {
+          int32_t highest = candidate + childLabels[count - 1];
+          if (highest >= (int32_t)base.size())
+          {
+            grow(std::max(highest + 1, (int32_t)base.size() * 2));
+          }
+
+          bool fits = true;
+          for (int i = 1; i < count && fits; i++)
+          {
+            fits = isFree(candidate + childLabels[i]);
+          }
+          if (fits) { return candidate; }
+        }
+        slot = nextFree[slot];
+      }
+    }
+
+    // Iterative on purpose: a recursive walk needs a frame per key character, and a long enough key
+    // would blow the builder thread's stack. Children are pushed in reverse so they still come off the
+    // stack in label order, which keeps the layout identical to a depth first recursion.
+    void insertAll()
+    {
+      pending.clear();
+      pending.push_back({ROOT, 0, (int32_t)order.size(), 0});
+      while (!pending.empty())
+      {
+        Range range = pending.back();
+        pending.pop_back();
+        insertRange(range);
+      }
+    }
+
+    // order[lo, hi) all share their first depth characters and end up in state.
+    void insertRange(Range range)
+    {
+      int32_t state = range.state;
+      int32_t lo    = range.lo;
+      int32_t hi    = range.hi;
+      int depth     = range.depth;
+
+      // shorter keys sort first, so anything ending here is at the front of the range
+      while (lo < hi && keys[order[lo]][depth] == '\0')
+      {
+        value[state] = order[lo];
+        lo++;
+      }
+      if (lo == hi) { return; }
+
+      int count = 0;
+      for (int32_t i = lo; i < hi; i++)
+      {
+        uint8_t c = (uint8_t)keys[order[i]][depth];
+        if (count == 0 || childLabels[count - 1] != c)
+        {
+          childLabels[count] = c;
+          groupStart[count]  = i;
+          count++;
+        }
+      }
+      groupStart[count] = hi;
+
+      int32_t stateBase = findBase(childLabels, count);
+      base[state] = stateBase;
+      childStart[state] = (int32_t)labels.size();
+      childCount[state] = (uint8_t)count;
+
+      // claim every child slot before descending so the subtrees can't take them from us
+      for (int i = 0; i < count; i++)
+      {
+        int32_t slot = stateBase + childLabels[i];
+        claim(slot);
+        check[slot] = state;
+        labels.push_back(childLabels[i]);
+      }
+
+      for (int i = count - 1; i >= 0; i--)
+      {
+        pending.push_back({stateBase + childLabels[i], groupStart[i], groupStart[i + 1], depth + 1});
+      }
+    }
+
+    // Breadth first so a state's fail target, which is always shallower, is done before we use it.
+    void buildLinks()
+    {
+      int32_t *fail   = trie->storage.data() + 2 * (size_t)trie->size;
+      int32_t *output = trie->storage.data() + 3 * (size_t)trie->size;
+      std::fill(output, output + trie->size, NO_MATCH);
+
+      std::vector<int32_t> queue;
+      queue.push_back(ROOT);
+      for (size_t head = 0; head < queue.size(); head++)
+      {
+        int32_t state = queue[head];
+        for (int i = 0; i < childCount[state]; i++)
+        {
+          uint8_t c     = labels[childStart[state] + i];
+          int32_t child = base[state] + c;
+
+          fail[child]   = state == ROOT ? ROOT : trie->next(fail[state], c);
+          output[child] = value[child] != NO_MATCH ? value[child] : output[fail[child]];
+          queue.push_back(child);
+        }
+      }
+    }
+  };
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include <SDL2/SDL_image.h>
 
 #include "AppData.hpp"
+#include "BulkIO.hpp"
 #include "Icons.hpp"
 #include "Input.hpp"
 #include "Platform.hpp"
@@ -30,6 +31,7 @@
 #include "imgui_impl_opengl3.h"
 #include "imgui_impl_sdl.h"
 #include "imgui_internal.h"
+#include "imgui_stdlib.h"
 
 // dictates the size of the columns for the trash and expansion icons (columns 3, 4, & 5)
 //           1                   2             3   4   5
@@ -49,6 +51,14 @@ class Editor
 public:
   inline static bool anInputIsActive;
   inline static bool showHelpMenu = false;
+  inline static bool showBulkMenu = false;
+  inline static std::string bulkPath;   // file the Import / Export popup works on
+  inline static std::string bulkResult; // how the last import or export went
+
+  // Rows keep their text packed in AppData::entries. Each cell is copied in here just long enough
+  // for ImGui to draw it, and only an edit that actually changed something is written back. ImGui
+  // works on its own copy while a field is active, so one buffer is enough for the whole table.
+  inline static std::string editBuffer;
   static void setEditorStyles()
   {
     ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, ImVec2(4, 4));
@@ -92,6 +102,61 @@ public:
     }
   }
 
+  // Moves the whole dictionary in or out of a CSV, TSV or JSON file, told apart by extension.
+  // Paths without a directory are next to config.abbrv.
+  static void showBulkTransfer(AppData* data)
+  {
+    if (showBulkMenu) { ImGui::OpenPopup("Import / Export"); }
+
+    ImVec2 center = ImGui::GetMainViewport()->GetCenter();
+    ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(600, 0));
+    if (ImGui::BeginPopupModal("Import / Export", &showBulkMenu, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+      ImGui::TextWrapped("A .csv, .tsv or .json file with a row per abbreviation. Importing merges it into the list, "
+                         "replacing the expansion of any abbreviation you already have.");
+      ImGui::Spacing();
+      ImGui::SetNextItemWidth(-1);
+      ImGui::InputTextWithHint("##path", "dictionary.tsv", &bulkPath);
+
+      BulkFormat format = BulkIO::formatOf(bulkPath.c_str());
+      BulkStats stats;
+      bool importing = false;
+      bool exporting = false;
+      ImGui::BeginDisabled(format == BULK_UNKNOWN);
+      if (ImGui::Button("Import")) { importing = true; }
+      ImGui::SameLine();
+      if (ImGui::Button("Export")) { exporting = true; }
+      ImGui::EndDisabled();
+
+      char result[256];
+      if (importing && data->importFile(bulkPath.c_str(), format, &stats))
+      {
+        snprintf(result, sizeof(result),
+                 "Imported %zu rows in %.2f s (%.0f rows/s): %zu added, %zu updated, %zu duplicates, %zu skipped",
+                 stats.rows, stats.seconds, stats.rowsPerSecond(), stats.added, stats.updated, stats.duplicates,
+                 stats.skipped);
+        bulkResult = result;
+      }
+      else if (importing)
+      {
+        if (stats.errorLine > 0) { snprintf(result, sizeof(result), "Couldn't read past line %zu", stats.errorLine); }
+        else { snprintf(result, sizeof(result), "Couldn't open %s", bulkPath.c_str()); }
+        bulkResult = result;
+      }
+      if (exporting && data->exportFile(bulkPath.c_str(), format, &stats))
+      {
+        snprintf(result, sizeof(result), "Exported %zu rows in %.2f s (%.0f rows/s)", stats.rows, stats.seconds,
+                 stats.rowsPerSecond());
+        bulkResult = result;
+      }
+      else if (exporting) { bulkResult = "Couldn't write " + bulkPath; }
+
+      if (!bulkResult.empty()) { ImGui::TextWrapped("%s", bulkResult.c_str()); }
+      ImGui::EndPopup();
+    }
+  }
+
   static void render(Platform* platform, Input* input, AppData* data)
   {
     anInputIsActive = false;
@@ -108,6 +173,12 @@ public:
 
     if (ImGui::BeginMainMenuBar())
     {
+      if (ImGui::BeginMenu("File"))
+      {
+        if (ImGui::MenuItem("Import / Export...")) { showBulkMenu = true; }
+        if (ImGui::MenuItem("Export as text")) { data->exportText(TEXT_EXPORT_FILE_NAME); }
+        ImGui::EndMenu();
+      }
 
       if (ImGui::BeginMenu("Help"))
       {
@@ -133,7 +204,7 @@ public:
       ImGui::EndMainMenuBar();
     }
 
-    int columns = 5; // abbreviation, expansion, multi-line/single-line toggle, delete entry
+    int columns = 6; // abbreviation, expansion, hidden, multi-line/single-line and paste toggles, delete entry
     bool open   = true;
     ImGui::SetNextWindowPos(ImVec2(0, 0));
     ImGui::SetNextWindowSize(ImVec2(screenWidth, screenHeight));
@@ -149,134 +220,166 @@ public:
       ImGui::TableSetupColumn("Expands To");
       ImGui::TableSetupColumn("##hidden", ImGuiTableColumnFlags_WidthFixed, UTIL_COLUMN_SIZE);
       ImGui::TableSetupColumn("##lines", ImGuiTableColumnFlags_WidthFixed, UTIL_COLUMN_SIZE);
+      ImGui::TableSetupColumn("##paste", ImGuiTableColumnFlags_WidthFixed, UTIL_COLUMN_SIZE);
       ImGui::TableSetupColumn("##delete", ImGuiTableColumnFlags_WidthFixed, UTIL_COLUMN_SIZE);
       ImGui::TableHeadersRow();
 
-      for (int row = 0; row < data->entries.size(); row++)
+      // force the text inputs to fill the entire table column
+      ImGui::TableSetColumnIndex(0);
+      ImGui::PushItemWidth(-FLT_MIN);
+      ImGui::TableSetColumnIndex(1);
+      ImGui::PushItemWidth(-FLT_MIN);
+
+      // Only the rows on screen are submitted, so only they copy their text into editBuffer. With
+      // --lazy-bodies that leaves every other expansion in the save file instead of paging it in.
+      ImGuiListClipper clipper;
+      clipper.Begin((int)data->entries.size());
+      while (clipper.Step())
       {
-        if (row == 0)
+        // a row deleted earlier in the frame makes the list shorter than the clipper thinks
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd && row < data->entries.size(); row++)
         {
-          // force the text inputs to fill the entire table column
-          ImGui::TableSetColumnIndex(0);
-          ImGui::PushItemWidth(-FLT_MIN);
-          ImGui::TableSetColumnIndex(1);
-          ImGui::PushItemWidth(-FLT_MIN);
-        }
-        int column = 0;
-        ImGui::TableNextRow();
-        { // abbreviation columns
-          ImGui::TableSetColumnIndex(column);
-          ImGui::PushID(row * columns + column); // assign unique id
-          if (ImGui::InputText("##v", data->entries[row].abbreviation, IM_ARRAYSIZE(data->entries[row].abbreviation)))
-          {
-            data->saveToFile();
+          int column = 0;
+          ImGui::TableNextRow();
+          { // abbreviation columns
+            ImGui::TableSetColumnIndex(column);
+            ImGui::PushID(row * columns + column); // assign unique id
+            editBuffer.assign(data->entries.key(row), data->entries.keys[row].length);
+            if (ImGui::InputText("##v", &editBuffer))
+            {
+              data->entries.setKey(row, editBuffer.data(), editBuffer.size());
+              data->updateEntry(row);
+            }
+            if (ImGui::IsItemActive() && ImGui::IsWindowFocused()) anInputIsActive = true;
+            ImGui::PopID();
           }
-          if (ImGui::IsItemActive() && ImGui::IsWindowFocused()) anInputIsActive = true;
-          ImGui::PopID();
-        }
 
-        { // expansion column
-          column = 1;
-          ImGui::TableSetColumnIndex(column);
-          // ImGui::Text("Row %d Column %d", row, column);
-          ImGui::PushID(row * columns + column); // assign unique id
-          ImGuiInputTextFlags flags = 0;
-          if (data->entries[row].isHiddenField) flags = ImGuiInputTextFlags_Password;
-          if (data->entries[row].isMultiline)
-          {
-            if (ImGui::InputTextMultiline("##v", data->entries[row].expandsTo,
-                                          IM_ARRAYSIZE(data->entries[row].expandsTo), ImVec2(0, 0), flags))
+          { // expansion column
+            column = 1;
+            ImGui::TableSetColumnIndex(column);
+            // ImGui::Text("Row %d Column %d", row, column);
+            ImGui::PushID(row * columns + column); // assign unique id
+            ImGuiInputTextFlags flags = 0;
+            if (data->entries.is(row, ENTRY_HIDDEN)) flags = ImGuiInputTextFlags_Password;
+            editBuffer.assign(data->entries.expansion(row), data->entries.expansions[row].length);
+            bool edited = false;
+            if (data->entries.is(row, ENTRY_MULTILINE))
             {
-              data->saveToFile();
+              edited = ImGui::InputTextMultiline("##v", &editBuffer, ImVec2(0, 0), flags);
+              if (ImGui::IsItemActive()) anInputIsActive = true;
             }
-            if (ImGui::IsItemActive()) anInputIsActive = true;
-          }
-          else
-          {
-            if (ImGui::InputText("##v", data->entries[row].expandsTo, IM_ARRAYSIZE(data->entries[row].expandsTo),
-                                 flags))
+            else
+            {
+              edited = ImGui::InputText("##v", &editBuffer, flags);
+              if (ImGui::IsItemActive()) anInputIsActive = true;
+            }
+            if (edited)
             {
-              data->saveToFile();
+              data->entries.setExpansion(row, editBuffer.data(), editBuffer.size());
+              data->updateEntry(row);
             }
-            if (ImGui::IsItemActive()) anInputIsActive = true;
+            ImGui::PopID();
           }
-          ImGui::PopID();
-        }
 
-        { // multi/single-line toggle column
-          column = 2;
+          { // multi/single-line toggle column
+            column = 2;
 
-          ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
-          ImGui::TableSetColumnIndex(column);
-          // ImGui::Text("Row %d Column %d", row, column);
-          ImGui::PushID(row * columns + column); // assign unique id
+            ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
+            ImGui::TableSetColumnIndex(column);
+            // ImGui::Text("Row %d Column %d", row, column);
+            ImGui::PushID(row * columns + column); // assign unique id
 
 
-          std::string icon = data->entries[row].isHiddenField ? ICON_FA_EYE_SLASH : ICON_FA_EYE;
-          if (ImGui::Button(icon.c_str(), button_size))
-          {
-            data->entries[row].isHiddenField = !data->entries[row].isHiddenField;
-            data->saveToFile();
-          }
-          if (ImGui::IsItemHovered())
-          {
-            std::string text = data->entries[row].isHiddenField ?
-                                   "Display the entry in plain text, readable by anyone." :
-                                   "Hide the contents of this field until this button is toggled again.";
-            ImGui::SetTooltip("%s", text.c_str());
+            std::string icon = data->entries.is(row, ENTRY_HIDDEN) ? ICON_FA_EYE_SLASH : ICON_FA_EYE;
+            if (ImGui::Button(icon.c_str(), button_size))
+            {
+              data->entries.toggle(row, ENTRY_HIDDEN);
+              data->updateEntry(row);
+            }
+            if (ImGui::IsItemHovered())
+            {
+              std::string text = data->entries.is(row, ENTRY_HIDDEN) ?
+                                     "Display the entry in plain text, readable by anyone." :
+                                     "Hide the contents of this field until this button is toggled again.";
+              ImGui::SetTooltip("%s", text.c_str());
+            }
+            ImGui::PopID();
           }
-          ImGui::PopID();
-        }
 
-        { // multi/single-line toggle column
-          column = 3;
+          { // multi/single-line toggle column
+            column = 3;
 
-          ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
-          ImGui::TableSetColumnIndex(column);
-          // ImGui::Text("Row %d Column %d", row, column);
-          ImGui::PushID(row * columns + column); // assign unique id
+            ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
+            ImGui::TableSetColumnIndex(column);
+            // ImGui::Text("Row %d Column %d", row, column);
+            ImGui::PushID(row * columns + column); // assign unique id
 
 
-          std::string icon = data->entries[row].isMultiline ? ICON_FA_MINUS : ICON_FA_BARS;
-          if (ImGui::Button(icon.c_str(), button_size))
-          {
-            data->entries[row].isMultiline = !data->entries[row].isMultiline;
-            data->saveToFile();
+            std::string icon = data->entries.is(row, ENTRY_MULTILINE) ? ICON_FA_MINUS : ICON_FA_BARS;
+            if (ImGui::Button(icon.c_str(), button_size))
+            {
+              data->entries.toggle(row, ENTRY_MULTILINE);
+              data->updateEntry(row);
+            }
+            if (ImGui::IsItemHovered())
+            {
+              std::string text = data->entries.is(row, ENTRY_MULTILINE) ? "Reduce to a single line entry" :
+                                                                           "Expand to a multiline entry";
+              ImGui::SetTooltip("%s", text.c_str());
+            }
+            ImGui::PopID();
           }
-          if (ImGui::IsItemHovered())
-          {
-            std::string text =
-                data->entries[row].isMultiline ? "Reduce to a single line entry" : "Expand to a multiline entry";
-            ImGui::SetTooltip("%s", text.c_str());
+
+          { // typed/pasted toggle column
+            column = 4;
+
+            ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
+            ImGui::TableSetColumnIndex(column);
+            ImGui::PushID(row * columns + column); // assign unique id
+
+            std::string icon = data->entries.is(row, ENTRY_PASTE) ? ICON_FA_CLIPBOARD : ICON_FA_KEYBOARD_O;
+            if (ImGui::Button(icon.c_str(), button_size))
+            {
+              data->entries.toggle(row, ENTRY_PASTE);
+              data->updateEntry(row);
+            }
+            if (ImGui::IsItemHovered())
+            {
+              std::string text = data->entries.is(row, ENTRY_PASTE) ?
+                                     "Type this expansion out key by key, unless it's very long." :
+                                     "Always paste this expansion from the clipboard instead of typing it.";
+              ImGui::SetTooltip("%s", text.c_str());
+            }
+            ImGui::PopID();
           }
-          ImGui::PopID();
-        }
 
-        { // delete columns
-          column = 4;
-          ImGui::TableSetColumnIndex(column);
-          // ImGui::Text("Row %d Column %d", row, column);
-          ImGui::PushID(row * columns + column); // assign unique id
-
-
-          ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
-          ImGui::PushStyleColor(ImGuiCol_Button, (ImVec4)ImColor::HSV(7.0f, 0.6f, 0.6f));
-          ImGui::PushStyleColor(ImGuiCol_ButtonHovered, (ImVec4)ImColor::HSV(7.0f, 0.7f, 0.7f));
-          ImGui::PushStyleColor(ImGuiCol_ButtonActive, (ImVec4)ImColor::HSV(7.0f, 0.8f, 0.8f));
-          if (ImGui::Button(ICON_FA_TRASH, button_size)) { data->deleteIndex(row); }
-          if (ImGui::IsItemHovered()) { ImGui::SetTooltip("Delete this pair. This cannot be undone."); }
-          ImGui::PopStyleColor(3);
-          ImGui::PopID();
+          { // delete columns
+            column = 5;
+            ImGui::TableSetColumnIndex(column);
+            // ImGui::Text("Row %d Column %d", row, column);
+            ImGui::PushID(row * columns + column); // assign unique id
+
+
+            ImVec2 button_size(UTIL_COLUMN_SIZE, ImGui::GetFontSize() * 2.0f);
+            ImGui::PushStyleColor(ImGuiCol_Button, (ImVec4)ImColor::HSV(7.0f, 0.6f, 0.6f));
+            ImGui::PushStyleColor(ImGuiCol_ButtonHovered, (ImVec4)ImColor::HSV(7.0f, 0.7f, 0.7f));
+            ImGui::PushStyleColor(ImGuiCol_ButtonActive, (ImVec4)ImColor::HSV(7.0f, 0.8f, 0.8f));
+            if (ImGui::Button(ICON_FA_TRASH, button_size)) { data->deleteIndex(row); }
+            if (ImGui::IsItemHovered()) { ImGui::SetTooltip("Delete this pair. This cannot be undone."); }
+            ImGui::PopStyleColor(3);
+            ImGui::PopID();
+          }
         }
       }
       ImGui::EndTable();
 
       ImVec2 button_size(ImGui::GetFontSize() * 3.0f, ImGui::GetFontSize() * 2.0f);
-      if (ImGui::Button(ICON_FA_PLUS, button_size)) { data->entries.push_back({}); }
+      if (ImGui::Button(ICON_FA_PLUS, button_size)) { data->addEntry(); }
       if (ImGui::IsItemHovered()) { ImGui::SetTooltip("Add a new abbreviation & expansion pair."); }
     }
 
     showFAQ();
+    showBulkTransfer(data);
     ImGui::End();
   }
 };
@@ -0,0 +1,153 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef ENTRY_TABLE_HPP
+#define ENTRY_TABLE_HPP
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "ExpansionStore.hpp"
+#include "StringArena.hpp"
+
+#define ENTRY_MULTILINE 1
+#define ENTRY_HIDDEN    2
+#define ENTRY_PASTE     4 // pasted from the clipboard however short it is, see AppData::pasteAbove
+
+// The dictionary as the editor sees it, one row per entry in display order, stored a column at a
+// time. Everything a pass over the whole dictionary looks at (ids, flags, keys) is dense and packed
+// together; expansions get a column and an arena of their own, so rebuilding the index or drawing
+// the table never pulls expansion text through the cache. That only gets read when an entry is
+// matched, edited or saved.
+//
+// Loaded with lazy bodies, expansions start out in `store` instead of expansionText and only move
+// over once they're edited; `stored` says which is which.
+class EntryTable
+{
+public:
+  size_t size() const { return ids.size(); }
+
+  void reserve(size_t rows)
+  {
+    ids.reserve(rows);
+    flags.reserve(rows);
+    keys.reserve(rows);
+    expansions.reserve(rows);
+    stored.reserve(rows);
+  }
+
+  void clear()
+  {
+    ids.clear();
+    flags.clear();
+    keys.clear();
+    expansions.clear();
+    stored.clear();
+    keyText.clear();
+    expansionText.clear();
+    store.reset();
+  }
+
+  // Appends a row and returns its index
+  int add(int id, const char *key, size_t keyLength, const char *expansion, size_t expansionLength, uint8_t flag)
+  {
+    ids.push_back(id);
+    flags.push_back(flag);
+    keys.push_back(keyText.add(key, keyLength));
+    expansions.push_back(expansionText.add(expansion, expansionLength));
+    stored.push_back(false);
+    return (int)ids.size() - 1;
+  }
+
+  // Appends a row whose expansion is already in `store`
+  int addStored(int id, const char *key, size_t keyLength, StringRef expansion, uint8_t flag)
+  {
+    ids.push_back(id);
+    flags.push_back(flag);
+    keys.push_back(keyText.add(key, keyLength));
+    expansions.push_back(expansion);
+    stored.push_back(true);
+    return (int)ids.size() - 1;
+  }
+
+  void erase(int row)
+  {
+    keyText.remove(keys[row]);
+    if (!stored[row]) { expansionText.remove(expansions[row]); }
+    ids.erase(ids.begin() + row);
+    flags.erase(flags.begin() + row);
+    keys.erase(keys.begin() + row);
+    expansions.erase(expansions.begin() + row);
+    stored.erase(stored.begin() + row);
+  }
+
+  const char *key(int row) const { return keyText.get(keys[row]); }
+  const char *expansion(int row) const
+  {
+    return stored[row] ? store->get(expansions[row]) : expansionText.get(expansions[row]);
+  }
+
+  bool is(int row, uint8_t flag) const { return flags[row] & flag; }
+  void toggle(int row, uint8_t flag) { flags[row] ^= flag; }
+
+  void setKey(int row, const char *text, size_t length) { replace(keys[row], keyText, keys, nullptr, text, length); }
+
+  void setExpansion(int row, const char *text, size_t length)
+  {
+    if (stored[row])
+    {
+      // nothing to free, the old text stays in the store
+      stored[row]     = false;
+      expansions[row] = StringRef();
+    }
+    replace(expansions[row], expansionText, expansions, &stored, text, length);
+  }
+
+  // hot, read on every rebuild and every frame of the editor
+  std::vector<int> ids; // stable handle AppData uses to find an entry in the trie, see AppData::addEntry()
+  std::vector<uint8_t> flags;
+  std::vector<StringRef> keys;
+  StringArena keyText;
+
+  // cold
+  std::vector<StringRef> expansions;
+  std::vector<uint8_t> stored; // expansion is in store rather than expansionText
+  StringArena expansionText;
+  std::shared_ptr<ExpansionStore> store;
+
+private:
+  // The old text stays behind in the arena. Once most of an arena is dead, copy its live strings
+  // into a fresh one in row order, skipping the rows `skip` says live somewhere else.
+  static void replace(StringRef &ref, StringArena &arena, std::vector<StringRef> &column,
+                      const std::vector<uint8_t> *skip, const char *text, size_t length)
+  {
+    arena.remove(ref);
+    ref = arena.add(text, length);
+    if (!arena.fragmented()) { return; }
+
+    StringArena packed;
+    packed.reserve(arena.liveBytes());
+    for (int row = 0; row < column.size(); row++)
+    {
+      if (skip != nullptr && (*skip)[row]) { continue; }
+      column[row] = packed.add(arena.get(column[row]), column[row].length);
+    }
+    arena.swap(packed);
+  }
+};
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef EXPANSION_STORE_HPP
+#define EXPANSION_STORE_HPP
+
+// Expansions the store keeps a private copy of, see ExpansionStore::hot()
+#define EXPANSION_CACHE_ENTRIES 64
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "MappedFile.hpp"
+#include "StringArena.hpp"
+
+// The expansion section of a save file loaded with lazy bodies, left mapped instead of copied
+// into memory. Every expansion in it is NUL terminated, so a StringRef into the section can be
+// used like one into a StringArena. The OS pages bodies in the first time they're looked at and
+// is free to drop them again, which keeps what's resident close to the size of the keys.
+//
+// Shared by the EntryTable it was loaded into, every copy of that table and every snapshot built
+// from it, so the mapping outlives all of them. The file on disk can be replaced in the meantime;
+// we keep reading the old one.
+class ExpansionStore
+{
+public:
+  const char *get(StringRef ref) const { return base + ref.offset; }
+
+  // The keyboard hook's way in. Going through the mapping can mean waiting on the disk for a body
+  // the OS dropped, so the last few expansions that fired are kept on the heap. The copy stays
+  // alive for as long as the caller holds on to it, even if it gets evicted in the meantime.
+  std::shared_ptr<const std::string> hot(StringRef ref)
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto found = cached.find(ref.offset);
+    if (found != cached.end())
+    {
+      recent.splice(recent.begin(), recent, found->second);
+      return found->second->second;
+    }
+
+    recent.emplace_front(ref.offset, std::make_shared<const std::string>(get(ref), ref.length));
+    cached[ref.offset] = recent.begin();
+    if (recent.size() > EXPANSION_CACHE_ENTRIES)
+    {
+      cached.erase(recent.back().first);
+      recent.pop_back();
+    }
+    return recent.front().second;
+  }
+
+  MappedFile file;
+  const char *base = nullptr; // start of the expansion section inside file
+
+private:
+  typedef std::pair<uint32_t, std::shared_ptr<const std::string>> CacheEntry;
+
+  std::mutex cacheMutex;
+  std::list<CacheEntry> recent; // most recently used first
+  std::unordered_map<uint32_t, std::list<CacheEntry>::iterator> cached;
+};
+
+#endif
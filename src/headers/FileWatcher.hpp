@@ -0,0 +1,63 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+// How often a watcher without OS notifications looks at the file
+#define FILE_WATCH_POLL_MS 1000
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+
+// Notices when a file is written, or replaced by renaming another one over it, which is how both
+// SaveFile and most sync tools update one. On Linux that's inotify on the directory holding it,
+// everywhere else (or if inotify isn't available) the file's size and modification time get
+// compared every FILE_WATCH_POLL_MS.
+//
+// Polled rather than calling back, so changes are picked up on whatever thread asks and nothing
+// else has to be thread safe.
+class FileWatcher
+{
+public:
+  FileWatcher() {}
+  ~FileWatcher() { stop(); }
+
+  FileWatcher(const FileWatcher &)            = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  void start(const char *path);
+  void stop();
+
+  // True once for every batch of changes since the last call. Cheap enough to call every frame.
+  // Our own writes count too, telling them apart is up to the caller.
+  bool changed();
+
+private:
+  bool poll();
+
+  std::string path;
+  std::string name; // path without the directory, what inotify reports
+  bool watching = false;
+  int notify    = -1;
+
+  std::chrono::steady_clock::time_point lastPoll;
+  uint64_t size    = 0;
+  int64_t modified = 0;
+};
+
+#endif
@@ -0,0 +1,326 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef INJECTION_HPP
+#define INJECTION_HPP
+
+// Key codes in a KeyStroke. These are the Windows virtual key numbers, the only layouts we fill
+// KeyMaps in from speak them; a backend for another OS translates as it sends.
+#define KEY_CODE_BACKSPACE 0x08
+#define KEY_CODE_RETURN    0x0D
+#define KEY_CODE_SHIFT     0xA0 // the left one
+#define KEY_CODE_CONTROL   0xA2 // the left one
+#define KEY_CODE_V         'V'
+
+// KeyStroke::flags
+#define KEY_STROKE_UP      1 // released, pressed otherwise
+#define KEY_STROKE_UNICODE 2 // key is a UTF-16 code unit to type rather than a key code
+
+// Most strokes KeyStrokeStream hands out at a time
+#define INJECTION_CHUNK_STROKES 256
+
+// Expansions longer than this are pasted rather than typed unless it's changed with --paste-above.
+// A character takes up to 4 key events, and some apps start dropping them long before this.
+#define PASTE_ABOVE_CHARACTERS 1024
+
+// Strokes of the paste chord, ctrl + v
+#define PASTE_STROKES 4
+
+// KeyScan, what VkKeyScanEx hands back: key code in the low byte, plus whether shift has to be held
+#define KEY_SCAN_SHIFT 0x100
+#define KEY_SCAN_NONE  0xFFFF // nothing on the layout types this character
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+typedef uint16_t KeyScan;
+
+// One key going down or up
+struct KeyStroke
+{
+  uint16_t key;
+  uint16_t flags;
+};
+
+// How to type each ASCII character on one keyboard layout. Filling it in is the only part of
+// planning that has to ask the OS, so that happens once per layout instead of once per character
+// typed. Anything past ASCII, or that the layout has no key for, is typed as Unicode.
+//
+// With `unicode` set everything printable is, which takes 2 events a UTF-16 code unit instead of
+// up to 4 a character and doesn't care about the layout at all. Some apps (games, remote desktops)
+// only listen for real keys, so it's opt in with --unicode-input. Control characters, line
+// breaks say, are still keys either way.
+struct KeyMap
+{
+  uint64_t layout = 0; // whatever the platform identifies the layout by, the HKL on Windows
+  bool unicode    = false;
+  KeyScan scans[128];
+
+  // A US layout without asking anyone, for the headless tools
+  static KeyMap usQwerty()
+  {
+    KeyMap map;
+    map.layout = 0x04090409;
+    for (int c = 0; c < 128; c++)
+    {
+      map.scans[c] = KEY_SCAN_NONE;
+    }
+    for (int c = 'a'; c <= 'z'; c++)
+    {
+      map.scans[c]             = (KeyScan)(c - 'a' + 'A');
+      map.scans[c - 'a' + 'A'] = (KeyScan)((c - 'a' + 'A') | KEY_SCAN_SHIFT);
+    }
+    const char *digits  = "0123456789";
+    const char *shifted = ")!@#$%^&*(";
+    for (int i = 0; i < 10; i++)
+    {
+      map.scans[(int)digits[i]]  = (KeyScan)digits[i];
+      map.scans[(int)shifted[i]] = (KeyScan)(digits[i] | KEY_SCAN_SHIFT);
+    }
+    const char *plain     = ";=,-./`[\\]'";
+    const char *withShift = ":+<_>?~{|}\"";
+    const KeyScan oem[]   = {0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF, 0xC0, 0xDB, 0xDC, 0xDD, 0xDE};
+    for (int i = 0; i < 11; i++)
+    {
+      map.scans[(int)plain[i]]     = oem[i];
+      map.scans[(int)withShift[i]] = (KeyScan)(oem[i] | KEY_SCAN_SHIFT);
+    }
+    map.scans[' ']  = ' ';
+    map.scans['\t'] = 0x09;
+    map.scans['\n'] = KEY_CODE_RETURN | KEY_SCAN_SHIFT; // see Platform::currentKeyMap()
+    return map;
+  }
+};
+
+// Most strokes an injection can take: down and up per backspace, and per byte of text the same
+// again with shift around it. Unicode never takes more, a UTF-16 code unit is at least 2 bytes of
+// UTF-8 unless it's ASCII.
+inline size_t maxKeyStrokes(int erase, size_t length) { return 2 * (size_t)erase + 4 * length; }
+
+// The code point starting at text[*at], moving *at past it. Anything that isn't well formed UTF-8
+// comes out as U+FFFD a byte at a time.
+inline uint32_t decodeUtf8(const char *text, size_t length, size_t *at)
+{
+  const unsigned char *bytes = (const unsigned char *)text + *at;
+  size_t left                = length - *at;
+  uint32_t lead              = bytes[0];
+  int extra                  = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+  uint32_t point             = extra == 3 ? lead & 0x07 : extra == 2 ? lead & 0x0F : lead & 0x1F;
+  *at += 1;
+  if (extra == 0 || lead >= 0xF8 || left <= (size_t)extra) { return lead < 0x80 ? lead : 0xFFFD; }
+
+  for (int i = 1; i <= extra; i++)
+  {
+    if ((bytes[i] & 0xC0) != 0x80) { return 0xFFFD; }
+    point = (point << 6) | (bytes[i] & 0x3F);
+  }
+  const uint32_t smallest[] = {0, 0x80, 0x800, 0x10000};
+  if (point < smallest[extra] || point > 0x10FFFF || (point >= 0xD800 && point <= 0xDFFF)) { return 0xFFFD; }
+  *at += extra;
+  return point;
+}
+
+// Where a chunk of text may end without splitting a character, as close to `end` as it can
+inline size_t utf8Boundary(const char *text, size_t begin, size_t end, size_t length)
+{
+  size_t at = end;
+  while (at > begin && at < length && (text[at] & 0xC0) == 0x80 && end - at < 3) { at--; }
+  return at > begin && (at == length || (text[at] & 0xC0) != 0x80) ? at : end;
+}
+
+inline size_t unicodeStrokes(uint32_t point, KeyStroke *out)
+{
+  uint16_t units[2] = {(uint16_t)point, 0};
+  int count         = 1;
+  if (point >= 0x10000)
+  {
+    units[0] = (uint16_t)(0xD800 + ((point - 0x10000) >> 10));
+    units[1] = (uint16_t)(0xDC00 + ((point - 0x10000) & 0x3FF));
+    count    = 2;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    out[2 * i]     = {units[i], KEY_STROKE_UNICODE};
+    out[2 * i + 1] = {units[i], KEY_STROKE_UNICODE | KEY_STROKE_UP};
+  }
+  return 2 * count;
+}
+
+// How many bytes at the start of an abbreviation can stay where they are because the expansion
+// starts with them too, addr -> address only has to type "ess". Never splits a character.
+inline size_t sharedPrefix(const char *key, size_t keyLength, const char *text, size_t length)
+{
+  size_t shared = 0;
+  size_t limit  = std::min(keyLength, length);
+  while (shared < limit && key[shared] == text[shared]) { shared++; }
+  while (shared > 0 && shared < length && (text[shared] & 0xC0) == 0x80) { shared--; }
+  return shared;
+}
+
+// Turns an injection into the keys to press, into `out` which has room for maxKeyStrokes().
+// Control characters the layout can't type are left out. Returns the number of strokes written.
+inline size_t planKeyStrokes(const KeyMap &map, int erase, const char *text, size_t length, KeyStroke *out)
+{
+  size_t count = 0;
+  for (int i = 0; i < erase; i++)
+  {
+    out[count++] = {KEY_CODE_BACKSPACE, 0};
+    out[count++] = {KEY_CODE_BACKSPACE, KEY_STROKE_UP};
+  }
+
+  for (size_t i = 0; i < length;)
+  {
+    unsigned char byte = (unsigned char)text[i];
+    KeyScan scan       = byte < 0x80 ? map.scans[byte] : KEY_SCAN_NONE;
+    if (scan == KEY_SCAN_NONE || (map.unicode && byte >= 0x20))
+    {
+      uint32_t point = decodeUtf8(text, length, &i);
+      if (point >= 0x20 && point != 0x7F) { count += unicodeStrokes(point, out + count); }
+      continue;
+    }
+    i++;
+
+    uint16_t key = scan & 0xFF;
+    bool shift   = scan & KEY_SCAN_SHIFT;
+    if (shift) { out[count++] = {KEY_CODE_SHIFT, 0}; }
+    out[count++] = {key, 0};
+    out[count++] = {key, KEY_STROKE_UP};
+    if (shift) { out[count++] = {KEY_CODE_SHIFT, KEY_STROKE_UP}; }
+  }
+  return count;
+}
+
+// One expansion firing: erase the abbreviation the user just typed and type the expansion in its
+// place, or rather only the part of each past what they have in common (sharedPrefix()). Usually
+// it comes planned already (see MatcherSnapshot::plan()), for the layout the snapshot was compiled
+// against.
+//
+// One that pastes still erases the abbreviation with backspaces, but then puts the expansion on
+// the clipboard and presses ctrl + v, which takes the same few milliseconds however long it is.
+struct Injection
+{
+  int erase;        // backspaces
+  const char *text; // what to type after them
+  size_t length;
+  const KeyStroke *strokes = nullptr; // null if it wasn't planned ahead
+  size_t strokeCount       = 0;
+  uint64_t layout          = 0; // KeyMap::layout the strokes were planned for
+  bool paste               = false;
+};
+
+// An injection's strokes a chunk at a time, its own plan if it was made for `map`'s layout,
+// otherwise planned as it goes. Either way it takes a fixed amount of memory however long the
+// expansion is, and nothing on the heap.
+class KeyStrokeStream
+{
+public:
+  KeyStrokeStream(const Injection &injection, const KeyMap &map)
+      : planned(!injection.paste && injection.strokes != nullptr && injection.layout == map.layout),
+        injection(injection), map(map)
+  {
+  }
+
+  // The next run of at most INJECTION_CHUNK_STROKES strokes, or null once there are none left.
+  // A run can be empty if none of the characters in it could be typed.
+  const KeyStroke *next(size_t *count)
+  {
+    if (planned)
+    {
+      if (position >= injection.strokeCount) { return nullptr; }
+      *count               = std::min((size_t)INJECTION_CHUNK_STROKES, injection.strokeCount - position);
+      const KeyStroke *run = injection.strokes + position;
+      position += *count;
+      return run;
+    }
+
+    if (erased < injection.erase)
+    {
+      int backspaces = std::min(injection.erase - erased, INJECTION_CHUNK_STROKES / 2);
+      *count         = planKeyStrokes(map, backspaces, nullptr, 0, buffer);
+      erased += backspaces;
+      return buffer;
+    }
+
+    if (injection.paste)
+    {
+      if (position > 0) { return nullptr; }
+      buffer[0] = {KEY_CODE_CONTROL, 0};
+      buffer[1] = {KEY_CODE_V, 0};
+      buffer[2] = {KEY_CODE_V, KEY_STROKE_UP};
+      buffer[3] = {KEY_CODE_CONTROL, KEY_STROKE_UP};
+      *count    = PASTE_STROKES;
+      position  = 1;
+      return buffer;
+    }
+
+    if (position >= injection.length) { return nullptr; }
+    size_t end = std::min(position + INJECTION_CHUNK_STROKES / 4, injection.length);
+    end        = utf8Boundary(injection.text, position, end, injection.length);
+    *count     = planKeyStrokes(map, 0, injection.text + position, end - position, buffer);
+    position   = end;
+    return buffer;
+  }
+
+  const bool planned;
+
+private:
+  const Injection &injection;
+  const KeyMap &map;
+  size_t position = 0; // into the plan, or the text while planning, 1 once a paste chord is out
+  int erased      = 0;
+  KeyStroke buffer[INJECTION_CHUNK_STROKES];
+};
+
+// Where an expansion ends up once it has matched. On Windows that's SendInput (see
+// Platform_Windows.hpp), the headless tools use RecordingSink instead.
+class InjectionSink
+{
+public:
+  virtual ~InjectionSink() {}
+  virtual void send(const Injection &injection) = 0;
+};
+
+// Tallies what would have been typed instead of typing it
+class RecordingSink : public InjectionSink
+{
+public:
+  void send(const Injection &injection) override
+  {
+    KeyStrokeStream stream(injection, keyMap);
+    size_t count = 0;
+    while (stream.next(&count) != nullptr)
+    {
+      strokes += count;
+    }
+    injections++;
+    erased += injection.erase;
+    typed += injection.length;
+    if (stream.planned) { planned++; }
+    if (injection.paste) { pasted++; }
+  }
+
+  KeyMap keyMap = KeyMap::usQwerty();
+
+  long long injections = 0;
+  long long erased     = 0;
+  long long typed      = 0;
+  long long strokes    = 0; // key events it would have taken
+  long long planned    = 0; // injections that came with a plan for keyMap
+  long long pasted     = 0;
+};
+
+#endif
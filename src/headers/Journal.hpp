@@ -0,0 +1,82 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#define JOURNAL_MAGIC   "ABBRVJNL"
+#define JOURNAL_VERSION 3
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "EntryTable.hpp"
+
+// One edit to the dictionary, by row, exactly as the editor made it. Replaying every op in order
+// on top of the save file the journal belongs to gives back the dictionary as it was.
+enum JournalOpType : uint8_t
+{
+  JOURNAL_UPSERT = 1, // replace the row, or append it when row is one past the end
+  JOURNAL_DELETE = 2,
+};
+
+struct JournalOp
+{
+  uint8_t type;
+  uint8_t flags; // ENTRY_MULTILINE | ENTRY_HIDDEN | ENTRY_PASTE
+  uint32_t row;
+  std::string key;
+  std::string expansion;
+};
+
+// The header ties a journal to the one save file it applies on top of, by the checksum at the end
+// of that file. Writing a new save file (compacting) leaves any old journal mismatched, so a crash
+// between the two steps can't replay edits that are already in the save file. Size and modification
+// time weren't enough for that: a same-size save on a filesystem with 2 second timestamps can look
+// identical to the one before it.
+//
+// |- header -|- length | checksum | type | flags | row | key length | key | expansion length | expansion -| ...
+//
+// Every record carries its own 4 byte length and 8 byte checksum of the rest (see Checksum.hpp). A
+// record that got cut short by a crash, and everything after it, is dropped on replay.
+struct JournalHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t padding;
+  uint64_t baseChecksum; // see SaveFile::readChecksum()
+};
+
+class Journal
+{
+public:
+  // Starts an empty journal on top of the save file with the given checksum, replacing any old one
+  static bool reset(const char *path, uint64_t baseChecksum);
+
+  // Adds ops to the end of the journal. Returns the number of bytes written, 0 on failure.
+  static uint64_t append(const char *path, const std::vector<JournalOp> &ops);
+
+  // Applies every intact op in the journal to entries, or only checks them when entries is null.
+  // Returns how many there were, or -1 when there is no journal for this save file. A torn tail is
+  // cut off the file so appending can carry on after the last good record; *size is set to what's
+  // left.
+  static int replay(const char *path, uint64_t baseChecksum, EntryTable *entries, uint64_t *size);
+
+  static bool apply(const JournalOp &op, EntryTable *entries);
+};
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef KEY_TRACE_HPP
+#define KEY_TRACE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <vector>
+
+#define KEY_TRACE_MAGIC   "ABBRVKEY"
+#define KEY_TRACE_VERSION 1
+
+// A recording of every character that reached Platform::onKeyPress, for replaying real typing
+// sessions through the matcher without a desktop (see tools/replay.cpp). After a short header
+// each keystroke is the time since the previous one in microseconds as a LEB128 varint, then the
+// character itself, so a typical keystroke costs 3 bytes.
+struct KeyTraceHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t padding;
+  int64_t startedAt; // wall clock microseconds since the epoch, only for the humans reading it
+};
+
+struct KeyEvent
+{
+  uint64_t time; // microseconds since the start of the trace
+  char pressed;
+};
+
+class KeyTraceWriter
+{
+public:
+  ~KeyTraceWriter() { close(); }
+
+  bool open(const char *path);
+  void close();
+  bool isOpen() const { return file != nullptr; }
+
+  // Called from the keyboard hook, so this only ever appends to a buffer. The buffer hits the disk
+  // from writeBuffered() and close().
+  void record(char pressed)
+  {
+    uint64_t now   = microseconds();
+    uint64_t delta = now - last;
+    last           = now;
+    do
+    {
+      uint8_t byte = delta & 0x7F;
+      delta >>= 7;
+      buffer.push_back(delta ? byte | 0x80 : byte);
+    } while (delta);
+    buffer.push_back((uint8_t)pressed);
+  }
+
+  // Called once a frame. Writes the buffer out once it holds 64KB (~20k keystrokes). The hook runs
+  // on the same thread as the frame loop, between frames, so the two never touch the buffer at once.
+  void writeBuffered()
+  {
+    if (buffer.size() >= FLUSH_SIZE) { flush(); }
+  }
+
+private:
+  inline static const size_t FLUSH_SIZE = 64 * 1024;
+
+  uint64_t microseconds() const
+  {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  }
+  void flush();
+
+  using Clock = std::chrono::steady_clock;
+
+  FILE *file = nullptr;
+  Clock::time_point start;
+  uint64_t last = 0;
+  std::vector<uint8_t> buffer;
+};
+
+class KeyTraceReader
+{
+public:
+  ~KeyTraceReader() { close(); }
+
+  bool open(const char *path);
+  void close();
+
+  // false once the trace runs out, or if it's cut off mid keystroke
+  bool next(KeyEvent *event);
+
+  KeyTraceHeader header = {};
+
+private:
+  FILE *file    = nullptr;
+  uint64_t time = 0;
+};
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <stddef.h>
+
+#if WIN32
+#include <windows.h>
+#endif
+
+// A read-only view of a whole file. The OS pages it in on demand and shares those pages between
+// every process that maps the same file.
+class MappedFile
+{
+public:
+  MappedFile() {}
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile &)            = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool open(const char *path);
+  void close();
+  bool isOpen() const { return data != nullptr; }
+
+  // Done with everything before `offset` for now. Lets a single pass over a file much bigger than
+  // memory keep only what it's looking at resident; anything touched again just gets paged back in.
+  void release(size_t offset);
+
+  const char *data = nullptr;
+  size_t size      = 0;
+
+private:
+#if WIN32
+  HANDLE file    = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+#else
+  int file = -1;
+#endif
+};
+
+#endif
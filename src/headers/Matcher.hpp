@@ -0,0 +1,458 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef MATCHER_HPP
+#define MATCHER_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Debug.hpp"
+#include "DoubleArray.hpp"
+#include "ExpansionStore.hpp"
+#include "Injection.hpp"
+#include "MappedFile.hpp"
+#include "MatcherImage.hpp"
+#include "RollingHash.hpp"
+#include "Trie.hpp"
+
+// SnapshotEntry::flags
+#define SNAPSHOT_ENTRY_LIVE      1 // an entry with this id exists, ids of deleted entries are left as holes
+#define SNAPSHOT_ENTRY_MULTILINE 2
+#define SNAPSHOT_ENTRY_HIDDEN    4
+#define SNAPSHOT_ENTRY_STORED    8 // the expansion offset is into `store` rather than strings
+#define SNAPSHOT_ENTRY_PASTE     16
+
+// Most a snapshot spends on keystroke plans. Entries past it are planned when they fire instead,
+// like lazy bodies always are.
+#define SNAPSHOT_PLAN_BYTES (64 * 1024 * 1024)
+
+// Which structure we match keystrokes against. They all fire on exactly the same keystrokes, they
+// only trade speed for memory. The pointer trie takes exactly one lookup per keystroke but costs
+// ~1KB per node. The double array is a few int32s per node, which is what you want once a
+// dictionary grows into the tens of thousands of entries. The rolling hash doesn't walk a tree at
+// all and costs one probe per distinct key length, see RollingHash.hpp.
+enum MatcherEngine
+{
+  ENGINE_TRIE,
+  ENGINE_DOUBLE_ARRAY,
+  ENGINE_ROLLING_HASH,
+};
+
+inline const char *engineName(MatcherEngine engine)
+{
+  if (engine == ENGINE_TRIE) { return "trie"; }
+  if (engine == ENGINE_ROLLING_HASH) { return "rolling-hash"; }
+  return "double-array";
+}
+
+// for picking an engine on the command line
+inline bool parseEngine(const char *name, MatcherEngine *engine)
+{
+  if (strcmp(name, "trie") == 0) { *engine = ENGINE_TRIE; }
+  else if (strcmp(name, "double-array") == 0) { *engine = ENGINE_DOUBLE_ARRAY; }
+  else if (strcmp(name, "rolling-hash") == 0) { *engine = ENGINE_ROLLING_HASH; }
+  else { return false; }
+  return true;
+}
+
+// What the keyboard hook needs to know about an entry once its abbreviation has been typed.
+// Offsets point into MatcherSnapshot::strings.
+struct SnapshotEntry
+{
+  uint32_t keyOffset;
+  uint32_t keyLength;
+  uint32_t expansionOffset;
+  uint32_t expansionLength;
+  uint32_t flags;
+};
+
+// Where an entry's keystrokes sit in MatcherSnapshot::planStrokes
+struct KeyPlan
+{
+  uint32_t offset;
+  uint32_t length; // 0 if the entry wasn't planned
+  uint32_t kept;   // bytes of the abbreviation the expansion starts with, see sharedPrefix()
+};
+
+// Where a reader is in the automaton between keystrokes. Only meaningful for the snapshot it was
+// last used with, so it remembers that snapshot's generation and starts over when it changes.
+struct MatchCursor
+{
+  uint64_t generation = UINT64_MAX; // no snapshot has this one, so the first advance() starts over
+  TrieNode *node      = nullptr;
+  int32_t state       = DoubleArrayTrie::ROOT;
+  RollingWindow window;
+
+  void reset(TrieNode *root)
+  {
+    node         = root;
+    state        = DoubleArrayTrie::ROOT;
+    window.typed = 0;
+  }
+};
+
+// Everything the keystroke path needs, compiled from the dictionary and never modified once it
+// has been published. Entries are indexed by entry id (EntryTable::ids) and carry their own copy of the
+// key and expansion text, so a reader never has to look at AppData::entries.
+//
+// Like the double array, entries and strings are views. They point at entryStorage and
+// stringStorage for a snapshot we built ourselves, or into `image` when the whole thing was
+// loaded from disk by MatcherImage::load.
+struct MatcherSnapshot
+{
+  MatcherEngine engine = ENGINE_DOUBLE_ARRAY;
+  uint64_t generation  = 0; // assigned by SnapshotSlot::publish
+  uint64_t revision    = 0; // of the dictionary the entries were copied from, see AppData::revision
+
+  Arena<TrieNode> nodes;
+  TrieNode *root = nullptr;
+  DoubleArrayTrie compact;
+  RollingHashIndex hashed;
+
+  const SnapshotEntry *entries = nullptr;
+  uint32_t entryCount          = 0;
+  const char *strings          = nullptr;
+  uint64_t stringsSize         = 0;
+
+  std::vector<SnapshotEntry> entryStorage;
+  std::vector<char> stringStorage;
+  std::vector<int32_t> rows; // entry ids in the order they were added, which is the editor's row order
+  MappedFile image;
+  std::shared_ptr<ExpansionStore> store; // lazy bodies, see addStoredEntry()
+
+  // The layout compile() plans every resident expansion's keystrokes for, so firing one is only
+  // copying them out. None for snapshots loaded from an image, those plan as they fire. Plans
+  // only erase and retype what differs between the abbreviation and the expansion.
+  std::shared_ptr<const KeyMap> keyMap;
+  std::vector<KeyPlan> plans; // by entry id
+  std::vector<KeyStroke> planStrokes;
+  size_t pasteAbove = PASTE_ABOVE_CHARACTERS; // see AppData::pasteAbove
+
+  // Where compile() should leave a copy of this snapshot, and the save file it was built from so
+  // the copy can tell if it's gone stale. Empty when nobody wants an image.
+  std::string imagePath;
+  uint64_t sourceSize    = 0;
+  int64_t sourceModified = 0;
+
+  const char *key(int entry) const { return &strings[entries[entry].keyOffset]; }
+  const char *expansion(int entry) const
+  {
+    const SnapshotEntry &found = entries[entry];
+    if (found.flags & SNAPSHOT_ENTRY_STORED) { return store->get({found.expansionOffset, found.expansionLength}); }
+    return &strings[found.expansionOffset];
+  }
+
+  // Whether entry goes out through the clipboard rather than being typed
+  bool pastes(int entry) const
+  {
+    const SnapshotEntry &found = entries[entry];
+    return (found.flags & SNAPSHOT_ENTRY_PASTE) || (pasteAbove > 0 && found.expansionLength > pasteAbove);
+  }
+
+  // How much of entry's key can be left in place, `text` being its expansion
+  size_t kept(int entry, const char *text) const
+  {
+    const SnapshotEntry &found = entries[entry];
+    if (entry < plans.size() && !(found.flags & SNAPSHOT_ENTRY_STORED)) { return plans[entry].kept; }
+    return sharedPrefix(key(entry), found.keyLength, text, found.expansionLength);
+  }
+
+  // The strokes that turn entry's key into its expansion on keyMap's layout, or null
+  const KeyStroke *plan(int entry, size_t *count) const
+  {
+    if (entry >= plans.size() || plans[entry].length == 0) { return nullptr; }
+    *count = plans[entry].length;
+    return &planStrokes[plans[entry].offset];
+  }
+
+  // Both strings are stored NUL terminated so they can be handed to C APIs as they are
+  void addEntry(int id, const char *key, const char *expansion, uint32_t flags)
+  {
+    SnapshotEntry &entry  = addKey(id, key, flags);
+    entry.expansionLength = (uint32_t)strlen(expansion);
+    entry.expansionOffset = (uint32_t)stringStorage.size();
+    stringStorage.insert(stringStorage.end(), expansion, expansion + entry.expansionLength + 1);
+  }
+
+  // Only the key gets copied, the expansion stays where it is in `store`
+  void addStoredEntry(int id, const char *key, StringRef expansion, uint32_t flags)
+  {
+    SnapshotEntry &entry  = addKey(id, key, flags | SNAPSHOT_ENTRY_STORED);
+    entry.expansionLength = expansion.length;
+    entry.expansionOffset = expansion.offset;
+  }
+
+  SnapshotEntry &addKey(int id, const char *key, uint32_t flags)
+  {
+    if (id >= entryStorage.size()) { entryStorage.resize(id + 1, {0, 0, 0, 0, 0}); }
+
+    rows.push_back(id);
+    SnapshotEntry &entry = entryStorage[id];
+    entry.flags          = flags | SNAPSHOT_ENTRY_LIVE;
+    entry.keyLength      = (uint32_t)strlen(key);
+    entry.keyOffset      = (uint32_t)stringStorage.size();
+    stringStorage.insert(stringStorage.end(), key, key + entry.keyLength + 1);
+    return entry;
+  }
+
+  // The expensive half of building a snapshot, safe to run on any thread since nothing else can
+  // see the snapshot yet. The trie engine expects `root` to already hold the goto edges.
+  void compile()
+  {
+    entries     = entryStorage.data();
+    entryCount  = (uint32_t)entryStorage.size();
+    strings     = stringStorage.data();
+    stringsSize = stringStorage.size();
+
+    if (engine == ENGINE_TRIE)
+    {
+      if (root == nullptr) { root = TrieNode::getNode(nodes); }
+      TrieNode::buildLinks(root);
+    }
+    else
+    {
+      std::vector<const char *> keys(entryCount, nullptr);
+      for (int i = 0; i < entryCount; i++)
+      {
+        if (entries[i].keyLength > 0) { keys[i] = key(i); }
+      }
+      if (engine == ENGINE_ROLLING_HASH) { hashed.build(keys, rows); }
+      else { compact.build(keys, rows); }
+    }
+
+    planKeys();
+
+    DEBUG("Compiled matcher snapshot, %zu bytes of index", indexBytes());
+    if (!imagePath.empty()) { MatcherImage::write(*this, imagePath, sourceSize, sourceModified); }
+  }
+
+  void planKeys()
+  {
+    plans.assign(entryCount, {0, 0, 0});
+    for (int i = 0; i < entryCount; i++)
+    {
+      const SnapshotEntry &entry = entries[i];
+      if (!(entry.flags & SNAPSHOT_ENTRY_LIVE) || (entry.flags & SNAPSHOT_ENTRY_STORED)) { continue; }
+
+      const char *text = expansion(i);
+      size_t kept      = sharedPrefix(key(i), entry.keyLength, text, entry.expansionLength);
+      plans[i].kept    = (uint32_t)kept;
+      if (keyMap == nullptr || pastes(i)) { continue; }
+
+      int erase     = (int)(entry.keyLength - kept);
+      size_t offset = planStrokes.size();
+      size_t most   = maxKeyStrokes(erase, entry.expansionLength - kept);
+      if ((offset + most) * sizeof(KeyStroke) > SNAPSHOT_PLAN_BYTES) { continue; }
+
+      planStrokes.resize(offset + most);
+      size_t length = planKeyStrokes(*keyMap, erase, text + kept, entry.expansionLength - kept, &planStrokes[offset]);
+      planStrokes.resize(offset + length);
+      plans[i].offset = (uint32_t)offset;
+      plans[i].length = (uint32_t)length;
+    }
+    planStrokes.shrink_to_fit();
+  }
+
+  size_t indexBytes() const
+  {
+    if (engine == ENGINE_TRIE) { return nodes.bytes(); }
+    if (engine == ENGINE_ROLLING_HASH) { return hashed.bytes(); }
+    return compact.bytes();
+  }
+
+  // Feeds one keystroke through the automaton. Returns the id of the entry whose abbreviation was
+  // just completed, or -1. Once something fires the typed text gets replaced, so the cursor
+  // starts matching from scratch.
+  int advance(MatchCursor &cursor, char c) const
+  {
+    if (cursor.generation != generation)
+    {
+      cursor.generation = generation;
+      cursor.reset(root);
+    }
+
+    int index = (unsigned char)c;
+    if (index >= ALPHABET_SIZE)
+    {
+      cursor.reset(root);
+      return -1;
+    }
+
+    int match = -1;
+    if (engine == ENGINE_TRIE)
+    {
+      cursor.node = cursor.node->children[index];
+      if (cursor.node->output != nullptr) { match = cursor.node->output->entry; }
+    }
+    else if (engine == ENGINE_ROLLING_HASH) { match = hashed.advance(cursor.window, index); }
+    else
+    {
+      cursor.state = compact.next(cursor.state, index);
+      match        = compact.output[cursor.state];
+    }
+
+    if (match != -1) { cursor.reset(root); }
+    return match;
+  }
+};
+
+// Holds the currently published snapshot. Readers never block: they bump a counter, load the
+// pointer and go. Writers swap in a new snapshot with one atomic exchange and park the old one
+// until they've seen the reader count drop to zero. Any reader that could still be looking at the
+// old snapshot must have bumped the counter before the exchange, so zero afterwards means nobody
+// is left.
+class SnapshotSlot
+{
+public:
+  SnapshotSlot() : current(new MatcherSnapshot()) { current.load()->compile(); }
+  ~SnapshotSlot()
+  {
+    delete current.load();
+    for (int i = 0; i < retired.size(); i++)
+    {
+      delete retired[i];
+    }
+  }
+
+  SnapshotSlot(const SnapshotSlot &)            = delete;
+  SnapshotSlot &operator=(const SnapshotSlot &) = delete;
+
+  const MatcherSnapshot *acquire()
+  {
+    readers.fetch_add(1);
+    return current.load();
+  }
+
+  void release() { readers.fetch_sub(1); }
+
+  void publish(MatcherSnapshot *snapshot)
+  {
+    snapshot->generation = nextGeneration.fetch_add(1);
+    MatcherSnapshot *old = current.exchange(snapshot);
+    {
+      std::lock_guard<std::mutex> lock(retiredMutex);
+      retired.push_back(old);
+    }
+    reclaim();
+  }
+
+  // Frees retired snapshots once no reader can be holding them. Called after every publish and
+  // periodically from the main loop in case a reader was busy the first time around.
+  void reclaim()
+  {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    if (retired.empty() || readers.load() != 0) { return; }
+
+    for (int i = 0; i < retired.size(); i++)
+    {
+      delete retired[i];
+    }
+    retired.clear();
+  }
+
+private:
+  std::atomic<MatcherSnapshot *> current;
+  std::atomic<int> readers{0};
+  std::atomic<uint64_t> nextGeneration{1};
+
+  std::mutex retiredMutex;
+  std::vector<MatcherSnapshot *> retired;
+};
+
+// Scoped read access to the published snapshot.
+struct SnapshotReader
+{
+  SnapshotSlot *slot;
+  const MatcherSnapshot *snapshot;
+
+  SnapshotReader(SnapshotSlot *slot) : slot(slot), snapshot(slot->acquire()) {}
+  ~SnapshotReader() { slot->release(); }
+
+  SnapshotReader(const SnapshotReader &)            = delete;
+  SnapshotReader &operator=(const SnapshotReader &) = delete;
+};
+
+// Background thread that finishes compiling snapshots and publishes them. Only the newest
+// submitted snapshot matters, so if several arrive while one is compiling the older ones are
+// dropped without ever being compiled.
+class MatcherBuilder
+{
+public:
+  MatcherBuilder(SnapshotSlot *slot) : slot(slot) {}
+  ~MatcherBuilder() { stop(); }
+
+  void submit(MatcherSnapshot *snapshot)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!thread.joinable()) { thread = std::thread(&MatcherBuilder::run, this); }
+      delete pending;
+      pending = snapshot;
+    }
+    wake.notify_one();
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    if (thread.joinable()) { thread.join(); }
+
+    delete pending;
+    pending  = nullptr;
+    stopping = false;
+  }
+
+private:
+  void run()
+  {
+    while (true)
+    {
+      MatcherSnapshot *snapshot = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || pending != nullptr; });
+        if (stopping) { return; }
+        snapshot = pending;
+        pending  = nullptr;
+      }
+
+      snapshot->compile();
+      slot->publish(snapshot);
+    }
+  }
+
+  SnapshotSlot *slot;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  MatcherSnapshot *pending = nullptr;
+  bool stopping            = false;
+};
+
+#endif
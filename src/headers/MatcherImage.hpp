@@ -0,0 +1,74 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef MATCHER_IMAGE_HPP
+#define MATCHER_IMAGE_HPP
+
+#include <stdint.h>
+
+#include <string>
+
+#define MATCHER_IMAGE_MAGIC   "ABBRVIMG"
+#define MATCHER_IMAGE_VERSION 2
+
+struct MatcherSnapshot;
+
+// A compiled double array snapshot written to disk exactly as it sits in memory, so loading it
+// is a single mmap and no parsing at all. Every section is an array of plain integers or chars
+// addressed by offsets from the start of the file, which means the mapping works at whatever
+// address the OS gives us and its pages are shared between every process that maps it.
+//
+// |- header -|- base | check | fail | output -|- entries -|- strings -|
+struct MatcherImageHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t engine;
+  uint64_t sourceSize;    // the save file this was compiled from, so we can tell if the image is
+  int64_t sourceModified; // older than the save file and needs to be thrown away
+  uint32_t slotCount;
+  uint32_t keyCount;
+  uint32_t entryCount;
+  uint32_t padding;
+  uint64_t arraysOffset;
+  uint64_t entriesOffset;
+  uint64_t stringsOffset;
+  uint64_t stringsSize;
+  uint64_t sectionsChecksum; // of the arrays, entries and strings, padding between them left out
+  uint64_t checksum;         // of every field above
+};
+
+class MatcherImage
+{
+public:
+  // Writes next to the real file first and renames it over, so a reader never maps a half
+  // written image. The source stamp is whatever sourceStamp() said about the save file the
+  // snapshot's entries came from.
+  static bool write(const MatcherSnapshot &snapshot, const std::string &path, uint64_t sourceSize,
+                    int64_t sourceModified);
+
+  // Maps and validates an image. Returns nullptr if it's missing, corrupt, or wasn't built from
+  // the save file as it exists right now.
+  static MatcherSnapshot *load(const char *path, uint64_t sourceSize, int64_t sourceModified);
+
+  // Size and modification time of the save file, used to decide whether an image is stale
+  static bool sourceStamp(const char *path, uint64_t *size, int64_t *modified);
+
+private:
+  static uint64_t headerChecksum(const MatcherImageHeader &header);
+  static uint64_t sectionsChecksum(const MatcherSnapshot &snapshot);
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include <string>
 
 #include "AppData.hpp"
+#include "KeyTrace.hpp"
 
 #if WIN32
 #include <windows.h>
@@ -56,7 +57,16 @@ public:
   static int isCapsLockActive();
   static void registerKeyboardHook();
   static void onKeyPress(char pressed);
-  static void simulateKeyboardInput(int abbreviationLength, std::string toSend);
+  static void simulateKeyboardInput(KeyStrokeStream& stream);
+
+  // Puts an expansion on the clipboard for an injection to paste, keeping what was there to put
+  // back once the paste has landed. False if it couldn't, the expansion gets typed instead.
+  static bool stageClipboard(const char* text, size_t length);
+  static void restoreClipboard(bool now = false); // every frame, and on the way out with now
+
+  // The keyboard layout expansions are typed on right now. Changing layouts swaps in a new map and
+  // has the matcher recompiled, so its keystroke plans follow along.
+  static const KeyMap& currentKeyMap();
 
   std::string version = "1.6";
 
@@ -65,6 +75,13 @@ public:
   SDL_Renderer* renderer;
 
   static AppData* data;
+  inline static MatcherEngine engine = ENGINE_DOUBLE_ARRAY; // picked with --engine on the command line
+  inline static bool lazyBodies       = false;               // --lazy-bodies, see AppData::lazyBodies
+  inline static size_t pasteAbove     = PASTE_ABOVE_CHARACTERS; // --paste-above, see AppData::pasteAbove
+  inline static bool unicodeInput     = false;               // --unicode-input, see KeyMap::unicode
+
+  // Only open when started with --record-keys <path>, see KeyTrace.hpp
+  inline static KeyTraceWriter keyTrace;
 
 
   bool isRunning;
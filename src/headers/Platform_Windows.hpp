@@ -22,6 +22,14 @@
 
 #define NEW_LINE_KEY 10
 
+// Inputs handed to SendInput per call. However long an expansion is, it goes out through the same
+// preallocated ring in runs of about this many.
+#define INJECTION_RING_INPUTS 512
+
+// How long a pasted expansion stays on the clipboard before what was there gets put back. The
+// target app reads the clipboard whenever it gets around to the ctrl + v, not when we send it.
+#define PASTE_RESTORE_MS 500
+
 typedef BOOL(WINAPI* MINIDUMPWRITEDUMP)(HANDLE hProcess,
                                         DWORD dwPid,
                                         HANDLE hFile,
@@ -58,29 +66,57 @@ int Platform::isShiftActive() { return GetKeyState(VK_LSHIFT) < 0 || GetKeyState
 
 int Platform::isCapsLockActive() { return (GetKeyState(VK_CAPITAL) & 1) == 1; }
 
+// Types expansions into whatever window has focus
+class SendInputSink : public InjectionSink
+{
+public:
+  void send(const Injection& injection) override
+  {
+    // typed after all if the clipboard can't be had, pasting would put whatever is on it there
+    Injection sent = injection;
+    if (sent.paste && !Platform::stageClipboard(sent.text, sent.length)) { sent.paste = false; }
+
+    KeyStrokeStream stream(sent, Platform::currentKeyMap());
+    Platform::simulateKeyboardInput(stream);
+  }
+};
+
+const KeyMap& Platform::currentKeyMap()
+{
+  HKL layout = GetKeyboardLayout(0);
+  if (data->keyMap != nullptr && data->keyMap->layout == (uint64_t)(uintptr_t)layout) { return *data->keyMap; }
+
+  std::shared_ptr<KeyMap> map = std::make_shared<KeyMap>();
+  map->layout                 = (uint64_t)(uintptr_t)layout;
+  map->unicode                = unicodeInput;
+  for (int c = 0; c < 128; c++)
+  {
+    map->scans[c] = (KeyScan)VkKeyScanEx((CHAR)c, layout);
+  }
+  // line breaks have always gone out as shift + enter
+  if (map->scans[NEW_LINE_KEY] != KEY_SCAN_NONE) { map->scans[NEW_LINE_KEY] |= KEY_SCAN_SHIFT; }
+
+  DEBUG("Keyboard layout is now %p, replanning expansions", (void*)layout);
+  data->keyMap       = map;
+  data->matcherDirty = true;
+  return *map;
+}
+
 void Platform::onKeyPress(char pressed)
 {
   DEBUG("Input received. char: %c, value of %d", pressed, (int)pressed);
 
-  const int MODIFIER_PRESSED = -52; // both alt and ctrl return -52 and we don't want to consider
-                                    // these "breaks" in the matching chain so don't report them
-  const int SHIFT_RELEASED = 0;     // we also need to ignore when shift is released for the same
-                                    // reasons
-
+  // recorded before any filtering so a replay sees exactly what we saw
+  if (keyTrace.isOpen()) { keyTrace.record(pressed); }
 
-  // finally, if our Editor inputs are active we also want to bail because we don't want the
-  // autocomplete triggering while the user is editing their settings.
+  // if our Editor inputs are active we want to bail because we don't want the autocomplete
+  // triggering while the user is editing their settings.
   bool windowHasInputFocus       = (SDL_GetWindowFlags(Platform::window) & SDL_WINDOW_INPUT_FOCUS);
   bool inputsAndWindowAreaActive = Editor::anInputIsActive && windowHasInputFocus;
-  if (pressed == MODIFIER_PRESSED || pressed == SHIFT_RELEASED || inputsAndWindowAreaActive) return;
+  if (inputsAndWindowAreaActive) return;
 
-  data->advanceSearches(pressed);
-  Abbreviation* toSend = data->checkForCompletions();
-  if (toSend != nullptr)
-  {
-    std::string s(toSend->expandsTo);
-    simulateKeyboardInput((int)strlen(toSend->abbreviation), s);
-  }
+  static SendInputSink sink;
+  data->onKeyPress(pressed, &sink);
 }
 
 void Platform::addTrayIcon(SDL_Window* window)
@@ -144,77 +180,160 @@ LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
   return CallNextHookEx(NULL, nCode, wParam, lParam);
 }
 
-void Platform::simulateKeyboardInput(int abbreviationLength, std::string toSend)
+// Static so the hook's stack stays small and nothing gets allocated per expansion. Only the
+// fields a stroke sets are ever written, the rest are still zero from when the program loaded.
+static INPUT injectionRing[INJECTION_RING_INPUTS];
+
+void Platform::simulateKeyboardInput(KeyStrokeStream& stream)
 {
   // disable our hook here so we can't have an abbreviation that creates an expansion which
   // creates an abbreviation which creates an expansion which creates an expansion...
   UnhookWindowsHookEx(keyboardHook);
-  HKL kbl = GetKeyboardLayout(0);
 
+  // Each SendInput call lands in one piece, but other input can get in between two of them, so a
+  // run only ends while shift is up. A shifted character is 4 strokes, which is the slack left.
+  UINT filled    = 0;
+  bool shiftHeld = false;
+  size_t count   = 0;
+  const KeyStroke* run;
+  while ((run = stream.next(&count)) != nullptr)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      bool unicode     = run[i].flags & KEY_STROKE_UNICODE;
+      INPUT& input     = injectionRing[filled++];
+      input.type       = INPUT_KEYBOARD;
+      input.ki.wVk     = unicode ? 0 : run[i].key;
+      input.ki.wScan   = unicode ? run[i].key : 0;
+      input.ki.dwFlags = (unicode ? KEYEVENTF_UNICODE : 0) | ((run[i].flags & KEY_STROKE_UP) ? KEYEVENTF_KEYUP : 0);
+      if (!unicode && run[i].key == KEY_CODE_SHIFT) { shiftHeld = !(run[i].flags & KEY_STROKE_UP); }
+
+      if (filled == INJECTION_RING_INPUTS || (filled > INJECTION_RING_INPUTS - 4 && !shiftHeld))
+      {
+        SendInput(filled, injectionRing, sizeof(INPUT));
+        filled = 0;
+      }
+    }
+  }
+  if (filled > 0) { SendInput(filled, injectionRing, sizeof(INPUT)); }
+
+  registerKeyboardHook();
+}
+
+// Whatever was on the clipboard before an expansion got pasted over it
+struct SavedClipboard
+{
+  std::vector<UINT> formats;
+  std::vector<std::string> contents;
+  DWORD sequence      = 0; // GetClipboardSequenceNumber() once our expansion was on it
+  ULONGLONG restoreAt = 0;
+  bool pending        = false;
+};
 
-  // key up + key down & room for shift up+ shift down
-  const int maximumPossibleSendInputs = 4 * EXPAND_MAX_SIZE;
-  const int backSpacesRequired        = 2 * ABBREVIATION_MAX_SIZE; // key up + key down for each
+static SavedClipboard savedClipboard;
 
-  INPUT inputs[backSpacesRequired + maximumPossibleSendInputs] = {};
-  int inputCount                                               = 0;
+static HWND clipboardOwner()
+{
+  SDL_SysWMinfo info;
+  SDL_VERSION(&info.version);
+  return SDL_GetWindowWMInfo(Platform::window, &info) ? info.info.win.window : NULL;
+}
 
-  // send a backspace for each character in our abbreviation
-  for (int i = 0; i < abbreviationLength; i++)
+// Bitmaps, metafiles and palettes are GDI handles rather than memory we could copy, those don't
+// survive a paste
+static bool isMemoryFormat(UINT format)
+{
+  return format != CF_BITMAP && format != CF_DSPBITMAP && format != CF_PALETTE && format != CF_METAFILEPICT &&
+         format != CF_DSPMETAFILEPICT && format != CF_ENHMETAFILE && format != CF_DSPENHMETAFILE &&
+         format != CF_OWNERDISPLAY;
+}
+
+static bool setClipboardBytes(UINT format, const void* bytes, size_t size)
+{
+  HGLOBAL memory = GlobalAlloc(GMEM_MOVEABLE, size);
+  if (memory == NULL) { return false; }
+  memcpy(GlobalLock(memory), bytes, size);
+  GlobalUnlock(memory);
+  if (SetClipboardData(format, memory) != NULL) { return true; }
+  GlobalFree(memory);
+  return false;
+}
+
+bool Platform::stageClipboard(const char* text, size_t length)
+{
+  // expansions are UTF-8 with \n line breaks, the clipboard wants UTF-16 with \r\n
+  std::string lines;
+  lines.reserve(length + length / 32);
+  for (size_t i = 0; i < length; i++)
   {
-    inputs[inputCount]            = {};
-    inputs[inputCount].type       = INPUT_KEYBOARD;
-    inputs[inputCount].ki.wVk     = VK_BACK;
-    inputs[inputCount].ki.dwFlags = 0;
-    inputCount += 1;
-
-    inputs[inputCount]            = {};
-    inputs[inputCount].type       = INPUT_KEYBOARD;
-    inputs[inputCount].ki.wVk     = VK_BACK;
-    inputs[inputCount].ki.dwFlags = KEYEVENTF_KEYUP;
-    inputCount += 1;
+    if (text[i] == NEW_LINE_KEY && (i == 0 || text[i - 1] != '\r')) { lines.push_back('\r'); }
+    lines.push_back(text[i]);
   }
+  int wideLength = MultiByteToWideChar(CP_UTF8, 0, lines.data(), (int)lines.size(), NULL, 0);
+  std::wstring wide(wideLength, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, lines.data(), (int)lines.size(), &wide[0], wideLength);
 
-  for (int characterIndex = 0; characterIndex < toSend.size(); characterIndex++)
+  if (!OpenClipboard(clipboardOwner()))
   {
-    SHORT vk           = VkKeyScanEx(toSend[characterIndex], kbl);
-    bool shiftModifier = vk & 0x100;
-    if ((int)toSend[characterIndex] == NEW_LINE_KEY) { shiftModifier = true; }
-    if (shiftModifier) // if shift was held
+    WARN("The clipboard is busy, typing the expansion instead");
+    return false;
+  }
+
+  // Pasting again before the last one was put back, the clipboard only holds our expansion
+  if (!savedClipboard.pending)
+  {
+    savedClipboard.formats.clear();
+    savedClipboard.contents.clear();
+    for (UINT format = EnumClipboardFormats(0); format != 0; format = EnumClipboardFormats(format))
     {
-      inputs[inputCount]            = {};
-      inputs[inputCount].type       = INPUT_KEYBOARD;
-      inputs[inputCount].ki.wVk     = VK_LSHIFT;
-      inputs[inputCount].ki.dwFlags = 0;
-      inputCount++;
+      if (!isMemoryFormat(format)) { continue; }
+      HANDLE handle     = GetClipboardData(format);
+      SIZE_T size       = handle != NULL ? GlobalSize(handle) : 0;
+      const void* bytes = size > 0 ? GlobalLock(handle) : nullptr;
+      if (bytes == nullptr) { continue; }
+      savedClipboard.formats.push_back(format);
+      savedClipboard.contents.emplace_back((const char*)bytes, size);
+      GlobalUnlock(handle);
     }
+  }
 
-    // KEY DOWN for the character
-    inputs[inputCount]            = {};
-    inputs[inputCount].ki.dwFlags = 0;
-    inputs[inputCount].type       = INPUT_KEYBOARD;
-    inputs[inputCount].ki.wVk     = vk & 0xFF;
-    inputCount++;
+  // Also keeps it out of clipboard history and cloud sync, hidden entries tend to be passwords
+  static UINT excludeFromHistory = RegisterClipboardFormat(_T("ExcludeClipboardContentFromMonitorProcessing"));
+  EmptyClipboard();
+  bool staged = setClipboardBytes(CF_UNICODETEXT, wide.c_str(), (wide.size() + 1) * sizeof(wchar_t));
+  if (staged && excludeFromHistory != 0) { setClipboardBytes(excludeFromHistory, "", 1); }
+  CloseClipboard();
+
+  // Emptied either way, so it gets put back either way
+  savedClipboard.sequence  = GetClipboardSequenceNumber();
+  savedClipboard.restoreAt = GetTickCount64() + PASTE_RESTORE_MS;
+  savedClipboard.pending   = true;
+  return staged;
+}
 
-    // KEY UP for the character
-    inputs[inputCount]            = {};
-    inputs[inputCount].type       = INPUT_KEYBOARD;
-    inputs[inputCount].ki.dwFlags = KEYEVENTF_KEYUP;
-    inputCount++;
+void Platform::restoreClipboard(bool now)
+{
+  if (!savedClipboard.pending || (!now && GetTickCount64() < savedClipboard.restoreAt)) { return; }
 
-    if (shiftModifier) // release shift if we sent it earlier
-    {
-      inputs[inputCount]            = {};
-      inputs[inputCount].type       = INPUT_KEYBOARD;
-      inputs[inputCount].ki.wVk     = VK_LSHIFT;
-      inputs[inputCount].ki.dwFlags = KEYEVENTF_KEYUP;
-      inputCount++;
-    }
+  // something else has been copied since, and that's what the user expects to find there
+  if (GetClipboardSequenceNumber() != savedClipboard.sequence)
+  {
+    savedClipboard.pending = false;
+    return;
   }
+  if (!OpenClipboard(clipboardOwner())) { return; } // someone else has it open, next frame then
 
-  SendInput(inputCount, inputs, sizeof(INPUT));
+  EmptyClipboard();
+  for (size_t i = 0; i < savedClipboard.formats.size(); i++)
+  {
+    const std::string& bytes = savedClipboard.contents[i];
+    setClipboardBytes(savedClipboard.formats[i], bytes.data(), bytes.size());
+  }
+  CloseClipboard();
 
-  registerKeyboardHook();
+  savedClipboard.formats.clear();
+  savedClipboard.contents.clear();
+  savedClipboard.pending = false;
 }
 
 void Platform::registerKeyboardHook()
@@ -0,0 +1,194 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef ROLLING_HASH_HPP
+#define ROLLING_HASH_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Debug.hpp"
+
+// Keystrokes the rolling hash engine remembers. A key has to fit in here, with one to spare,
+// to be matchable at all. Must be a power of two.
+#define ROLLING_HASH_WINDOW 1024
+
+// The last ROLLING_HASH_WINDOW keystrokes, and the hash of everything typed up to each of them.
+// Hashing a suffix of length L is then one multiply and one subtraction:
+//   hash(last L) = prefix[n] - prefix[n - L] * BASE^L
+struct RollingWindow
+{
+  uint64_t prefix[ROLLING_HASH_WINDOW] = {};
+  char recent[ROLLING_HASH_WINDOW]     = {};
+  uint64_t count                       = 0; // keystrokes seen, ever
+  uint32_t typed                       = 0; // keystrokes since the last reset, longer keys can't match
+};
+
+// Instead of walking a trie, look at what was just typed: for every distinct key length L in the
+// dictionary, hash the last L keystrokes and look that up in a flat open addressing table. Each
+// keystroke costs one probe per distinct key length no matter how long or similar the keys are,
+// which wins when a dictionary is full of long keys that share a prefix.
+struct RollingHashIndex
+{
+  inline static const int32_t NO_MATCH = -1;
+  inline static const uint64_t BASE    = 0x100000001b3ULL;
+
+  struct Slot
+  {
+    uint64_t hash;
+    int32_t entry; // NO_MATCH for an empty slot
+    uint32_t length;
+  };
+
+  std::vector<Slot> table;
+  uint64_t mask = 0;
+  std::vector<uint32_t> lengths; // every distinct key length, longest first
+  std::vector<uint64_t> powers;  // BASE^lengths[i]
+  std::vector<const char *> keys;
+  int32_t keyCount = 0;
+
+  static uint64_t hash(const char *key, size_t length)
+  {
+    uint64_t h = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+      h = h * BASE + (unsigned char)key[i] + 1;
+    }
+    return h;
+  }
+
+  // the low bits of a polynomial hash barely change between similar keys, so mix before masking
+  size_t home(uint64_t h) const { return (size_t)((h * 0x9E3779B97F4A7C15ULL) >> 32) & mask; }
+
+  size_t bytes() const
+  {
+    return table.size() * sizeof(Slot) + lengths.size() * (sizeof(uint32_t) + sizeof(uint64_t)) +
+           keys.size() * sizeof(const char *);
+  }
+
+  // Same contract as DoubleArrayTrie::build: keys[i] belongs to entry i, empty and non-ASCII keys
+  // are skipped and of two identical keys the one further down the rows wins. The key strings have
+  // to outlive the index since matches are verified against them.
+  void build(const std::vector<const char *> &input, const std::vector<int32_t> &rows)
+  {
+    keys     = input;
+    keyCount = 0;
+
+    size_t capacity = 16;
+    while (capacity < input.size() * 2)
+    {
+      capacity *= 2;
+    }
+    table.assign(capacity, {0, NO_MATCH, 0});
+    mask = capacity - 1;
+
+    std::vector<bool> seenLength;
+    for (int32_t i : rows)
+    {
+      const char *key = keys[i];
+      if (key == nullptr || key[0] == '\0') { continue; }
+
+      size_t length = strlen(key);
+      bool ascii    = true;
+      for (size_t j = 0; j < length; j++)
+      {
+        ascii = ascii && (unsigned char)key[j] < 128;
+      }
+      if (!ascii)
+      {
+        WARN("Skipping %s, it contains a non-ASCII character", key);
+        continue;
+      }
+      if (length >= ROLLING_HASH_WINDOW)
+      {
+        WARN("Skipping %s, the rolling hash engine only matches keys up to %d characters", key,
+             ROLLING_HASH_WINDOW - 1);
+        continue;
+      }
+
+      uint64_t h  = hash(key, length);
+      size_t slot = home(h);
+      for (; table[slot].entry != NO_MATCH; slot = (slot + 1) & mask)
+      {
+        const Slot &taken = table[slot];
+        if (taken.hash == h && taken.length == length && strcmp(keys[taken.entry], key) == 0) { break; }
+      }
+      if (table[slot].entry == NO_MATCH) { keyCount++; }
+      table[slot] = {h, i, (uint32_t)length};
+
+      if (seenLength.size() <= length) { seenLength.resize(length + 1, false); }
+      seenLength[length] = true;
+    }
+
+    lengths.clear();
+    powers.clear();
+    for (size_t length = seenLength.size(); length-- > 1;)
+    {
+      if (!seenLength[length]) { continue; }
+      uint64_t power = 1;
+      for (size_t j = 0; j < length; j++)
+      {
+        power *= BASE;
+      }
+      lengths.push_back((uint32_t)length);
+      powers.push_back(power);
+    }
+  }
+
+  // Feeds one keystroke into the window and returns the entry of the longest key the recent
+  // keystrokes end with, or NO_MATCH. Longest first is what the Aho-Corasick engines' output
+  // links give us too, so all the engines agree on what fires.
+  int32_t advance(RollingWindow &window, int c) const
+  {
+    const uint64_t WRAP = ROLLING_HASH_WINDOW - 1;
+
+    window.recent[window.count & WRAP] = (char)c;
+    uint64_t prefix                    = window.prefix[window.count & WRAP] * BASE + (unsigned)c + 1;
+    window.count++;
+    window.prefix[window.count & WRAP] = prefix;
+    if (window.typed < ROLLING_HASH_WINDOW - 1) { window.typed++; }
+
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+      uint32_t length = lengths[i];
+      if (length > window.typed) { continue; }
+
+      uint64_t h = prefix - window.prefix[(window.count - length) & WRAP] * powers[i];
+      for (size_t slot = home(h); table[slot].entry != NO_MATCH; slot = (slot + 1) & mask)
+      {
+        if (table[slot].hash != h || table[slot].length != length) { continue; }
+        if (endsWith(window, keys[table[slot].entry], length)) { return table[slot].entry; }
+      }
+    }
+    return NO_MATCH;
+  }
+
+  // a hash match is almost certainly the key, but make sure
+  static bool endsWith(const RollingWindow &window, const char *key, uint32_t length)
+  {
+    const uint64_t WRAP = ROLLING_HASH_WINDOW - 1;
+    uint64_t start      = window.count - length;
+    for (uint32_t j = 0; j < length; j++)
+    {
+      if (window.recent[(start + j) & WRAP] != key[j]) { return false; }
+    }
+    return true;
+  }
+};
+
+#endif
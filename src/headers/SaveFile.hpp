@@ -0,0 +1,328 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef SAVE_FILE_HPP
+#define SAVE_FILE_HPP
+
+#define ABBRV_SAVE_MAGIC        "ABBRV_SAVE_2"
+#define ABBRV_SAVE_FILE_VERSION "ABBRV_SAVE_1_0" // the text format, still around for exporting
+#define SAVE_FILE_NAME          "config.abbrv"
+#define IMAGE_FILE_NAME         SAVE_FILE_NAME ".image"
+#define JOURNAL_FILE_NAME       SAVE_FILE_NAME ".journal"
+#define TEXT_EXPORT_FILE_NAME   SAVE_FILE_NAME ".txt"
+
+// Edits are saved once the editor has been quiet for this long, or once this many have piled up
+// while someone keeps typing, whichever comes first.
+#define SAVE_QUIET_PERIOD_MS   1000
+#define SAVE_MAX_PENDING_EDITS 256
+
+// Past this the journal gets folded back into a fresh save file
+#define JOURNAL_COMPACT_BYTES (1024 * 1024)
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "EntryTable.hpp"
+#include "Journal.hpp"
+#include "MatcherImage.hpp"
+#include "Serialization.hpp"
+
+// The save file, a column at a time like EntryTable. Everything is little endian, rows are in
+// display order.
+//
+// |- header -|- flags -|- key lengths -|- expansion lengths -|- keys -|- expansions -|- checksum -|
+//
+// Flags are a byte per entry and lengths 32 bit. Keys and expansions are packed back to back, each
+// NUL terminated, so any of them can be used straight out of the mapped file; that's what lazy
+// bodies do with the expansions. The checksum is an FNV-1a of every byte before it, taken 8 bytes
+// at a time.
+struct SaveFileHeader
+{
+  char magic[12]; // ABBRV_SAVE_MAGIC, without the NUL
+  uint32_t padding;
+  uint64_t entryCount;
+  uint64_t keysSize; // including the NULs
+  uint64_t expansionsSize;
+};
+
+enum SaveFileStatus
+{
+  SAVE_FILE_LOADED,
+  SAVE_FILE_MISSING,
+  SAVE_FILE_OLDER_FORMAT, // text, see AppData::updateSaveFileFormat
+  SAVE_FILE_CORRUPT,
+};
+
+// One entry of a text save file, pointing into the file itself
+struct TextRecord
+{
+  std::string_view key;
+  std::string_view expansion;
+  uint8_t flags;
+};
+
+// Reads the entries out of a text save file one at a time, without copying anything. Handles
+// ABBRV_SAVE_1_0 and the unversioned format from before it, which is
+//
+//   <multiline 0 or 1> <key>DELIMITER<expansion>DELIMITER ...
+class TextRecordReader
+{
+public:
+  TextRecordReader(const char *data, size_t size);
+
+  bool next(TextRecord *record);
+
+  // Bytes of the file read so far
+  size_t position() const { return fields.position() - data; }
+
+  // next() stopped on something it couldn't parse rather than at the end of the file
+  bool failed = false;
+
+private:
+  const char *data;
+  FieldReader fields;
+  bool versioned;
+  int remaining = 0; // entries ABBRV_SAVE_1_0 says are left
+};
+
+// Called with how many bytes of a migration are done out of the total
+typedef void (*MigrationProgress)(size_t done, size_t total);
+
+class SaveFile
+{
+public:
+  // Both writers go to a temporary file next to `path` first, which is renamed over the old one,
+  // so a crash mid-write never leaves half a config. `checksum` gets the one written at the end.
+  static bool write(const EntryTable &entries, const char *path, uint64_t *checksum = nullptr);
+  static bool writeText(const EntryTable &entries, const char *path);
+
+  // Appends the rows in `path` to entries. Anything that fails the checksum or runs past the end
+  // of a section is CORRUPT, with entries left as they were.
+  //
+  // With `lazy` only the keys are read. The file stays mapped as entries->store and expansions
+  // are read out of it when something asks for them. Skips the checksum, since checking it would
+  // mean reading every expansion.
+  static SaveFileStatus read(const char *path, EntryTable *entries, bool lazy = false);
+
+  // The checksum at the end of a save file in the current format, without checking it. It's what a
+  // journal uses to tell the save file it goes on top of from any other. False for a text file.
+  static bool readChecksum(const char *path, uint64_t *checksum);
+
+  // Either text format, see TextRecordReader. False if `path` can't be opened or isn't text.
+  static bool readText(const char *path, EntryTable *entries);
+
+  // Rewrites the text save file at `path` in the current format in streaming passes, one to size
+  // the sections and then one per section of text. Only the flags and lengths, 9 bytes an entry,
+  // are kept in memory, so memory stays bounded however big the text is. The result replaces
+  // `path` atomically.
+  static bool migrate(const char *path, MigrationProgress progress);
+};
+
+// Background thread that owns everything on disk, so the editor never waits on it. Most saves
+// only append the ops made since the last one to the journal; once the journal outgrows
+// JOURNAL_COMPACT_BYTES the editor submits a full copy of the entries instead, which gets written
+// as a fresh save file with an empty journal on top.
+//
+// Jobs run in the order they were submitted. A compaction already contains every op queued
+// before it, so those get dropped without being written.
+class SaveWriter
+{
+public:
+  SaveWriter(const char *path, const char *journalPath) : path(path), journalPath(journalPath) {}
+  ~SaveWriter() { stop(); }
+
+  void append(std::vector<JournalOp> &&ops, uint64_t revision) { submit({std::move(ops), nullptr, revision}); }
+
+  // Takes ownership of `entries`, a copy of the whole dictionary as of `revision`
+  void compact(EntryTable *entries, uint64_t revision)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (int i = 0; i < queue.size(); i++)
+      {
+        delete queue[i].entries;
+      }
+      queue.clear();
+    }
+    submit({{}, entries, revision});
+  }
+
+  // Someone else replaced the save file with one holding the entries as of `revision`, with the
+  // given stamp and checksum. Starts an empty journal on top of it rather than writing it back out.
+  // A checksum of 0 means there's none to tie a journal to, a text file say, so the next save
+  // compacts instead.
+  void rebase(uint64_t size, int64_t modified, uint64_t checksum, uint64_t revision)
+  {
+    Job job;
+    job.rebase   = true;
+    job.size     = size;
+    job.modified = modified;
+    job.checksum = checksum;
+    job.revision = revision;
+    submit(std::move(job));
+  }
+
+  // Writes whatever is still queued, then shuts the thread down
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    if (thread.joinable()) { thread.join(); }
+    stopping = false;
+  }
+
+  // Picks up a journal that was already on disk at startup, `size` bytes of it valid
+  void resume(uint64_t size)
+  {
+    journalSize.store(size);
+    hasJournal.store(true);
+  }
+
+  // Revision of the entries the files on disk hold right now
+  uint64_t saved() const { return savedRevision.load(); }
+
+  // Bumped by every write, the save file's and journal's stamp changes each time
+  uint64_t writes() const { return writeCount.load(); }
+
+  // Whether the save file on disk with this stamp is the last one written or rebased onto here
+  bool wrote(uint64_t size, int64_t modified)
+  {
+    std::lock_guard<std::mutex> lock(stampMutex);
+    return size == stampSize && modified == stampModified;
+  }
+
+  // Appending needs a journal on top of the current save file, until then every save is a compaction
+  bool journaling() const { return hasJournal.load(); }
+  uint64_t journalBytes() const { return journalSize.load(); }
+
+private:
+  struct Job
+  {
+    std::vector<JournalOp> ops;
+    EntryTable *entries = nullptr; // set for a compaction
+    uint64_t revision   = 0;
+    bool rebase         = false; // see rebase(), with the stamp and checksum of the save file
+    uint64_t size       = 0;
+    int64_t modified    = 0;
+    uint64_t checksum   = 0;
+  };
+
+  void submit(Job &&job)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!thread.joinable()) { thread = std::thread(&SaveWriter::run, this); }
+      queue.push_back(std::move(job));
+    }
+    wake.notify_one();
+  }
+
+  void run()
+  {
+    while (true)
+    {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) { return; } // stopping, and nothing left to write
+        job = std::move(queue.front());
+        queue.pop_front();
+      }
+
+      bool written = false;
+      if (job.rebase) { written = writeRebase(job.size, job.modified, job.checksum); }
+      else { written = job.entries != nullptr ? writeSnapshot(*job.entries) : writeOps(job.ops); }
+      if (written) { savedRevision.store(job.revision); }
+      writeCount.fetch_add(1);
+      delete job.entries;
+    }
+  }
+
+  bool writeSnapshot(const EntryTable &entries)
+  {
+    uint64_t size     = 0;
+    int64_t modified  = 0;
+    uint64_t checksum = 0;
+    hasJournal.store(false);
+    if (!SaveFile::write(entries, path, &checksum)) { return false; }
+    if (!MatcherImage::sourceStamp(path, &size, &modified)) { return false; }
+    return writeRebase(size, modified, checksum);
+  }
+
+  bool writeRebase(uint64_t size, int64_t modified, uint64_t checksum)
+  {
+    {
+      std::lock_guard<std::mutex> lock(stampMutex);
+      stampSize     = size;
+      stampModified = modified;
+    }
+    hasJournal.store(false);
+    if (checksum == 0)
+    {
+      journalSize.store(0); // nothing to journal on top of, see rebase()
+      return true;
+    }
+    if (!Journal::reset(journalPath, checksum)) { return false; }
+
+    journalSize.store(sizeof(JournalHeader));
+    hasJournal.store(true);
+    return true;
+  }
+
+  bool writeOps(const std::vector<JournalOp> &ops)
+  {
+    // the editor checks journaling() before appending, this only happens if a write just failed
+    if (!hasJournal.load()) { return false; }
+
+    uint64_t written = Journal::append(journalPath, ops);
+    if (written == 0)
+    {
+      hasJournal.store(false);
+      return false;
+    }
+    journalSize.fetch_add(written);
+    return true;
+  }
+
+  const char *path;
+  const char *journalPath;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Job> queue;
+  bool stopping = false;
+
+  std::atomic<uint64_t> savedRevision{0};
+  std::atomic<uint64_t> writeCount{0};
+  std::atomic<bool> hasJournal{false};
+  std::atomic<uint64_t> journalSize{0};
+
+  std::mutex stampMutex;
+  uint64_t stampSize    = 0;
+  int64_t stampModified = 0;
+};
+
+#endif
@@ -16,7 +16,11 @@
 #ifndef SERIALIZATION_HPP
 #define SERIALIZATION_HPP
 
+#include <ctype.h>
+#include <string.h>
+
 #include <string>
+#include <string_view>
 
 class Serialization
 {
@@ -24,9 +28,6 @@ public:
   inline static int indent = 0;
 };
 
-template <typename T>
-T templated_parse(std::string value);
-
 // we need to use an unusual delimiter in the save format so that we can safely
 // accept _almost_ any input from the user in their abbreviations or expansions
 #define DELIMITER '\x1f'
@@ -39,6 +40,9 @@ T templated_parse(std::string value);
 
 #define WRITE(x) out << std::string(Serialization::indent, '\t') << #x << ":" << x << DELIMITER;
 
+// WRITE for when the label in the file isn't the expression that holds the value
+#define WRITE_AS(name, x) out << std::string(Serialization::indent, '\t') << name << ":" << x << DELIMITER;
+
 #define WRITE_ARRAY(x)                                                                                                 \
   out << std::string(Serialization::indent, '\t') << #x << ":ARRAY" << std::endl;                                      \
   out << std::string(Serialization::indent, '\t') << x.size() << std::endl;                                            \
@@ -58,39 +62,45 @@ T templated_parse(std::string value);
   Serialization::indent--;                                                                                             \
   out << std::string(Serialization::indent, '\t') << brace << DELIMITER;
 
-#define READ_CHAR_ARRAY(x)                                                                                             \
-  else if (label == #x && value != "ARRAY") { strcpy(x, value.c_str()); }
-
-#define READ(x)                                                                                                        \
-  else if (label == #x && value != "ARRAY") { x = templated_parse<decltype(x)>(value.c_str()); }
-
-#define READ_ARRAY(x)                                                                                                  \
-  else if (label == #x && value == "ARRAY")                                                                            \
-  {                                                                                                                    \
-    std::string read;                                                                                                  \
-    int arraySize = 0;                                                                                                 \
-    getline(in >> std::ws, read); /* the first line after the array declare is the size */                             \
-    arraySize = atoi(read.c_str());                                                                                    \
-    x.resize(arraySize);                                                                                               \
-    getline(in >> std::ws, read); /* throw away "[" */                                                                 \
-    for (int i = 0; i < arraySize; i++)                                                                                \
-    {                                                                                                                  \
-      in >> x[i];                                                                                                      \
-    }                                                                                                                  \
-    getline(in >> std::ws, read); /* throw away "]" */                                                                 \
-    label = "COMPLETED";          /* force our outer loop to continue */                                               \
+// Walks a text save file that's already in memory one field at a time, handing out views into
+// the buffer instead of copies. Skips whitespace in front of each field the same way
+// `getline(in >> std::ws, line, DELIMITER)` does, so both read the same fields.
+class FieldReader
+{
+public:
+  FieldReader(const char *data, size_t size) : cursor(data), end(data + size) {}
+
+  bool next(std::string_view *field, bool skipWhitespace = true)
+  {
+    while (skipWhitespace && cursor < end && isspace((unsigned char)*cursor))
+    {
+      cursor++;
+    }
+    if (cursor == end) { return false; }
+
+    const char *delimiter = (const char *)memchr(cursor, DELIMITER, end - cursor);
+    const char *stop      = delimiter != nullptr ? delimiter : end;
+    *field                = std::string_view(cursor, stop - cursor);
+    cursor                = delimiter != nullptr ? delimiter + 1 : end;
+    return true;
   }
 
-#define GET_LABEL_AND_VALUE                                                                                            \
-  for (int i = 0; i < line.size(); i++)                                                                                \
-  {                                                                                                                    \
-    if (line[i] == ':')                                                                                                \
-    {                                                                                                                  \
-      label = line.substr(0, i);                                                                                       \
-      value = line.substr(i + 1);                                                                                      \
-      break;                                                                                                           \
-    }                                                                                                                  \
+  // "label:value", split at the first ':'. Fields without one, like the braces, leave both alone.
+  static bool split(std::string_view field, std::string_view *label, std::string_view *value)
+  {
+    size_t colon = field.find(':');
+    if (colon == std::string_view::npos) { return false; }
+    *label = field.substr(0, colon);
+    *value = field.substr(colon + 1);
+    return true;
   }
 
+  // Where the next field starts
+  const char *position() const { return cursor; }
+
+private:
+  const char *cursor;
+  const char *end;
+};
 
 #endif
@@ -0,0 +1,92 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef STRING_ARENA_HPP
+#define STRING_ARENA_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+// Where a string lives inside a StringArena. Stays valid across growth of the arena, unlike a
+// pointer into it. The default value is the empty string.
+struct StringRef
+{
+  uint32_t offset = 0;
+  uint32_t length = 0; // not counting the NUL
+};
+
+// Every string packed back to back in one buffer, each NUL terminated so get() can go straight to
+// C APIs. Changing a string appends the new text and leaves the old bytes behind as garbage, which
+// is cheap per edit; whoever owns the handles repacks the live ones once fragmented() says so.
+//
+// Pointers from get() are only good until the next add().
+class StringArena
+{
+public:
+  StringArena() { clear(); }
+
+  StringRef add(const char *text, size_t length)
+  {
+    if (length == 0) { return {}; }
+
+    StringRef ref = {(uint32_t)bytes.size(), (uint32_t)length};
+    bytes.insert(bytes.end(), text, text + length);
+    bytes.push_back('\0');
+    return ref;
+  }
+
+  StringRef add(const char *text) { return add(text, strlen(text)); }
+
+  // The bytes stay where they are until the arena gets repacked, they just stop counting as live
+  void remove(StringRef ref)
+  {
+    if (ref.length > 0) { garbage += ref.length + 1; }
+  }
+
+  const char *get(StringRef ref) const { return &bytes[ref.offset]; }
+
+  // Offset 0 is a lone NUL that every empty string shares
+  void clear()
+  {
+    bytes.assign(1, '\0');
+    garbage = 0;
+  }
+
+  void reserve(size_t size) { bytes.reserve(size); }
+
+  void swap(StringArena &other)
+  {
+    bytes.swap(other.bytes);
+    std::swap(garbage, other.garbage);
+  }
+
+  // Worth repacking once more than half the buffer is dead text. The floor keeps a small
+  // dictionary that's being typed into from repacking on every other keystroke.
+  bool fragmented() const { return garbage > MIN_GARBAGE && garbage > bytes.size() / 2; }
+
+  size_t liveBytes() const { return bytes.size() - garbage; }
+  size_t bytesUsed() const { return bytes.capacity(); }
+
+private:
+  inline static const size_t MIN_GARBAGE = 64 * 1024;
+
+  std::vector<char> bytes;
+  size_t garbage = 0;
+};
+
+#endif
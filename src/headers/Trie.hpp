@@ -0,0 +1,222 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef TRIE_HPP
+#define TRIE_HPP
+
+// we allow all ASCII entries
+#define ALPHABET_SIZE 128
+
+#include <utility>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Debug.hpp"
+
+struct TrieNode
+{
+  bool terminal;
+  int entry;  // id of the entry whose key ends here
+  int owners; // how many entries share this exact key, the one in `entry` wins
+
+  // lets us walk back up from a terminal to prune a key we no longer know the text of
+  TrieNode *parent;
+  unsigned char label;
+
+  // Aho-Corasick links, filled in by buildLinks() once every key has been inserted.
+  // fail   -- the node for the longest proper suffix of this node's path that is also in the trie
+  // output -- the closest terminal node reachable through the fail chain, this node included
+  TrieNode *fail;
+  TrieNode *output;
+
+  // After buildLinks() every slot in children is populated so the trie behaves as a DFA: a
+  // keystroke is always a single lookup. This bitmask remembers which slots are actual trie edges
+  // and which ones are failure transitions we've filled in.
+  unsigned long long edges[ALPHABET_SIZE / 64];
+  TrieNode *children[ALPHABET_SIZE];
+
+  static bool hasEdge(TrieNode *node, int index) { return (node->edges[index / 64] >> (index % 64)) & 1ULL; }
+
+  // Returns the node the key ends at, or nullptr if the key can't be matched at all. Marking the
+  // node terminal is left to the caller since it's the one who knows about duplicate keys.
+  static TrieNode *insert(Arena<TrieNode> &nodes, TrieNode *root, const char *key)
+  {
+    if (key[0] == '\0') { return nullptr; } // an empty abbreviation never expands
+
+    TrieNode *current = root;
+    for (int i = 0; key[i] != '\0'; i++)
+    {
+      int index = (unsigned char)key[i];
+      if (index >= ALPHABET_SIZE)
+      {
+        WARN("Skipping %s, it contains a non-ASCII character", key);
+        remove(nodes, root, current);
+        return nullptr;
+      }
+
+      if (!hasEdge(current, index))
+      {
+        TrieNode *child          = getNode(nodes);
+        child->parent            = current;
+        child->label             = (unsigned char)index;
+        current->children[index] = child;
+        current->edges[index / 64] |= 1ULL << (index % 64);
+      }
+
+      current = current->children[index];
+    }
+
+    return current;
+  }
+
+  // Prunes node, and then every ancestor that no longer leads anywhere, back into the arena. The
+  // caller has already cleared `terminal` on node if it was one.
+  static void remove(Arena<TrieNode> &nodes, TrieNode *root, TrieNode *node)
+  {
+    while (node != root && !node->terminal && isLeaf(node))
+    {
+      TrieNode *parent              = node->parent;
+      parent->children[node->label] = nullptr;
+      parent->edges[node->label / 64] &= ~(1ULL << (node->label % 64));
+      nodes.free(node);
+      node = parent;
+    }
+  }
+
+  static bool isLeaf(TrieNode *node)
+  {
+    for (int i = 0; i < ALPHABET_SIZE / 64; i++)
+    {
+      if (node->edges[i]) { return false; }
+    }
+    return true;
+  }
+
+  static bool contains(TrieNode *root, std::string key)
+  {
+
+    TrieNode *current = root;
+
+    for (int i = 0; i < key.length(); i++)
+    {
+      int index = (unsigned char)key[i];
+      if (index >= ALPHABET_SIZE || !hasEdge(current, index)) { return false; }
+
+      current = current->children[index];
+    }
+
+    return current->terminal;
+  }
+
+  // Turns the trie into an Aho-Corasick automaton. We walk breadth first so that a node's fail
+  // target (always shallower) is finished before we need to borrow its transitions.
+  static void buildLinks(TrieNode *root)
+  {
+    std::vector<TrieNode *> queue;
+    root->fail   = root;
+    root->output = nullptr; // an empty abbreviation never expands
+
+    for (int c = 0; c < ALPHABET_SIZE; c++)
+    {
+      if (hasEdge(root, c))
+      {
+        TrieNode *child = root->children[c];
+        child->fail     = root;
+        child->output   = child->terminal ? child : nullptr;
+        queue.push_back(child);
+      }
+      else { root->children[c] = root; }
+    }
+
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+      TrieNode *node = queue[head];
+      for (int c = 0; c < ALPHABET_SIZE; c++)
+      {
+        if (hasEdge(node, c))
+        {
+          TrieNode *child = node->children[c];
+          child->fail     = node->fail->children[c];
+          child->output   = child->terminal ? child : child->fail->output;
+          queue.push_back(child);
+        }
+        else { node->children[c] = node->fail->children[c]; }
+      }
+    }
+  }
+
+  // Copies the real edges of a trie into another arena. The copy has no links until buildLinks().
+  // Walks with an explicit stack rather than recursing, so a very long key can't exhaust the stack.
+  static TrieNode *clone(Arena<TrieNode> &nodes, TrieNode *source, TrieNode *parent)
+  {
+    TrieNode *root = copyNode(nodes, source, parent);
+
+    std::vector<std::pair<TrieNode *, TrieNode *>> pending;
+    pending.push_back({source, root});
+    while (!pending.empty())
+    {
+      TrieNode *from = pending.back().first;
+      TrieNode *copy = pending.back().second;
+      pending.pop_back();
+
+      for (int c = 0; c < ALPHABET_SIZE; c++)
+      {
+        if (!hasEdge(from, c)) { continue; }
+        copy->children[c] = copyNode(nodes, from->children[c], copy);
+        copy->edges[c / 64] |= 1ULL << (c % 64);
+        pending.push_back({from->children[c], copy->children[c]});
+      }
+    }
+
+    return root;
+  }
+
+  static TrieNode *copyNode(Arena<TrieNode> &nodes, TrieNode *source, TrieNode *parent)
+  {
+    TrieNode *copy = getNode(nodes);
+    copy->terminal = source->terminal;
+    copy->entry    = source->entry;
+    copy->owners   = source->owners;
+    copy->parent   = parent;
+    copy->label    = source->label;
+    return copy;
+  }
+
+  static TrieNode *getNode(Arena<TrieNode> &nodes)
+  {
+    TrieNode *node = nodes.allocate();
+    node->terminal = false;
+    node->entry    = -1;
+    node->owners   = 0;
+    node->parent   = nullptr;
+    node->label    = 0;
+    node->fail     = nullptr;
+    node->output   = nullptr;
+
+    for (int i = 0; i < ALPHABET_SIZE / 64; i++)
+    {
+      node->edges[i] = 0;
+    }
+
+    for (int i = 0; i < ALPHABET_SIZE; i++)
+    {
+      node->children[i] = nullptr;
+    }
+
+    return node;
+  }
+};
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+// CSV imports are cut into BULK_CHUNK_BYTES chunks at row boundaries and parsed in parallel. A
+// quoted field with line breaks in it that runs across the cut must stay one row, wherever inside
+// it the cut would have gone.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <string>
+
+#include "BulkIO.hpp"
+#include "Test.hpp"
+
+// as written in the file, and as it should come out
+static const char *QUOTED   = "\"first line\nsecond \"\"quoted\"\" line\nthird line\n\nfifth line\"";
+static const char *UNQUOTED = "first line\nsecond \"quoted\" line\nthird line\n\nfifth line";
+
+static int find(const EntryTable &entries, const char *key)
+{
+  for (int row = 0; row < (int)entries.size(); row++)
+  {
+    if (strcmp(entries.key(row), key) == 0) { return row; }
+  }
+  return -1;
+}
+
+// A file whose quoted row starts `before` bytes ahead of the first chunk boundary
+static size_t writeFile(const char *path, size_t before)
+{
+  std::string csv = "abbreviation,expansion\n";
+  size_t start    = BULK_CHUNK_BYTES - before;
+  size_t rows     = 0;
+  char row[32];
+  while (start - csv.size() > 40)
+  {
+    snprintf(row, sizeof(row), "k%07zu,filler\n", rows++);
+    csv += row;
+  }
+  csv += "pad," + std::string(start - csv.size() - 5, 'x') + "\n";
+  rows++;
+
+  csv += "quoted,";
+  csv += QUOTED;
+  csv += "\nafter,\"the row after\"\nlast,row without a line break";
+  rows += 3;
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(csv.data(), csv.size());
+  return rows;
+}
+
+int main()
+{
+  testDirectory("bulk_io");
+
+  // the boundary lands on the key, right on the opening quote, on each of the line breaks inside,
+  // on the escaped quotes and on the closing quote
+  size_t offsets[] = {1, 7, 8, 18, 19, 27, 30, 45, 46, 58, 59, 60};
+  for (size_t offset : offsets)
+  {
+    size_t rows = writeFile("import.csv", offset);
+
+    EntryTable entries;
+    BulkStats stats;
+    CHECK(BulkIO::read("import.csv", BULK_CSV, &entries, &stats));
+    CHECK(stats.rows == rows);
+    CHECK(stats.added == rows);
+    CHECK(stats.skipped == 0);
+    CHECK(entries.size() == rows);
+
+    int quoted = find(entries, "quoted");
+    CHECK(quoted >= 0);
+    if (quoted >= 0)
+    {
+      CHECK(strcmp(entries.expansion(quoted), UNQUOTED) == 0);
+      CHECK(entries.is(quoted, ENTRY_MULTILINE));
+    }
+
+    int after = find(entries, "after");
+    int last  = find(entries, "last");
+    CHECK(after == quoted + 1);
+    CHECK(last == quoted + 2);
+    if (after >= 0) { CHECK(strcmp(entries.expansion(after), "the row after") == 0); }
+    if (last >= 0) { CHECK(strcmp(entries.expansion(last), "row without a line break") == 0); }
+  }
+
+  return testResult();
+}
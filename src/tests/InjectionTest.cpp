@@ -0,0 +1,131 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+// Turning an expansion into keystrokes with non-ASCII text in it: what's kept of the abbreviation
+// never ends halfway through a character, and everything past ASCII is typed as UTF-16.
+
+#include <string.h>
+
+#include <vector>
+
+#include "Injection.hpp"
+#include "Test.hpp"
+
+static size_t shared(const char *key, const char *text) { return sharedPrefix(key, strlen(key), text, strlen(text)); }
+
+static std::vector<KeyStroke> plan(const KeyMap &map, int erase, const char *text)
+{
+  size_t length = strlen(text);
+  std::vector<KeyStroke> strokes(maxKeyStrokes(erase, length));
+  strokes.resize(planKeyStrokes(map, erase, text, length, strokes.data()));
+  return strokes;
+}
+
+static bool is(const KeyStroke &stroke, uint16_t key, uint16_t flags)
+{
+  return stroke.key == key && stroke.flags == flags;
+}
+
+// down and up of one UTF-16 code unit
+static bool typesUnit(const std::vector<KeyStroke> &strokes, size_t at, uint16_t unit)
+{
+  return at + 1 < strokes.size() && is(strokes[at], unit, KEY_STROKE_UNICODE) &&
+         is(strokes[at + 1], unit, KEY_STROKE_UNICODE | KEY_STROKE_UP);
+}
+
+int main()
+{
+  // ASCII only
+  CHECK(shared("addr", "address") == 4);
+  CHECK(shared("teh", "the") == 1);
+  CHECK(shared("brb", "") == 0);
+
+  // the first byte of é matches nothing in "cafe"
+  CHECK(shared("cafe", "caf\xC3\xA9") == 3);
+  // é and è share their lead byte, which can't be kept on its own
+  CHECK(shared("caf\xC3\xA9s", "caf\xC3\xA8") == 3);
+  // whole characters are fine
+  CHECK(shared("\xC3\xA9t\xC3\xA9", "\xC3\xA9t\xC3\xA9 indien") == 5);
+  // a key that stops partway into € of the expansion
+  CHECK(sharedPrefix("ab\xE2\x82", 4, "ab\xE2\x82\xAC", 5) == 2);
+  // a 4 byte character that differs only in its last byte
+  CHECK(shared("x\xF0\x9F\x98\x80", "x\xF0\x9F\x98\x81") == 1);
+
+  KeyMap map = KeyMap::usQwerty();
+
+  { // backspaces, a layout key, a BMP character, one past it as a surrogate pair, and a line break
+    std::vector<KeyStroke> strokes = plan(map, 2, "a\xE2\x82\xAC\xF0\x9F\x98\x80\n");
+    CHECK(strokes.size() == 4 + 2 + 2 + 4 + 4);
+    if (strokes.size() == 16)
+    {
+      CHECK(is(strokes[0], KEY_CODE_BACKSPACE, 0));
+      CHECK(is(strokes[1], KEY_CODE_BACKSPACE, KEY_STROKE_UP));
+      CHECK(is(strokes[4], 'A', 0));
+      CHECK(is(strokes[5], 'A', KEY_STROKE_UP));
+      CHECK(typesUnit(strokes, 6, 0x20AC));
+      CHECK(typesUnit(strokes, 8, 0xD83D));
+      CHECK(typesUnit(strokes, 10, 0xDE00));
+      CHECK(is(strokes[12], KEY_CODE_SHIFT, 0));
+      CHECK(is(strokes[13], KEY_CODE_RETURN, 0));
+      CHECK(is(strokes[15], KEY_CODE_SHIFT, KEY_STROKE_UP));
+    }
+  }
+
+  { // shifted ASCII goes inside a shift press
+    std::vector<KeyStroke> strokes = plan(map, 0, "B!");
+    CHECK(strokes.size() == 8);
+    if (strokes.size() == 8)
+    {
+      CHECK(is(strokes[0], KEY_CODE_SHIFT, 0));
+      CHECK(is(strokes[1], 'B', 0));
+      CHECK(is(strokes[4], KEY_CODE_SHIFT, 0));
+      CHECK(is(strokes[5], '1', 0));
+    }
+  }
+
+  { // broken UTF-8 is a replacement character a byte, a stray continuation and a cut off lead
+    std::vector<KeyStroke> strokes = plan(map, 0, "\xFF\x80\xE2\x82");
+    CHECK(strokes.size() == 8);
+    for (size_t at = 0; at + 1 < strokes.size(); at += 2)
+    {
+      CHECK(typesUnit(strokes, at, 0xFFFD));
+    }
+  }
+
+  { // control characters the layout has no key for, and DEL, are left out
+    std::vector<KeyStroke> strokes = plan(map, 0, "a\x01\x7F" "b");
+    CHECK(strokes.size() == 4);
+  }
+
+  { // with Unicode input everything printable is a code unit, line breaks are still keys
+    KeyMap unicode  = map;
+    unicode.unicode = true;
+
+    std::vector<KeyStroke> strokes = plan(unicode, 0, "A\xC3\xA9\n");
+    CHECK(strokes.size() == 2 + 2 + 4);
+    CHECK(typesUnit(strokes, 0, 'A'));
+    CHECK(typesUnit(strokes, 2, 0xE9));
+    if (strokes.size() == 8) { CHECK(is(strokes[5], KEY_CODE_RETURN, 0)); }
+  }
+
+  { // never more than maxKeyStrokes, however the text is made up
+    const char *texts[] = {"\xF0\x9F\x98\x80\xF0\x9F\x98\x80", "~~~~", "\xE2\x82\xAC", "\n\n", ""};
+    for (const char *text : texts)
+    {
+      CHECK(plan(map, 3, text).size() <= maxKeyStrokes(3, strlen(text)));
+    }
+  }
+
+  return testResult();
+}
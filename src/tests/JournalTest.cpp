@@ -0,0 +1,130 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+// Replaying a journal on top of its save file: a record torn by a crash is cut off with everything
+// after it, and a journal left over from an older save file is never applied.
+
+#include <string.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Journal.hpp"
+#include "SaveFile.hpp"
+#include "Test.hpp"
+
+static void add(EntryTable &entries, const char *key, const char *expansion)
+{
+  entries.add((int)entries.size(), key, strlen(key), expansion, strlen(expansion), 0);
+}
+
+static JournalOp upsert(uint32_t row, const char *key, const char *expansion)
+{
+  return {JOURNAL_UPSERT, 0, row, key, expansion};
+}
+
+static bool hasRow(const EntryTable &entries, int row, const char *key, const char *expansion)
+{
+  return row < (int)entries.size() && strcmp(entries.key(row), key) == 0 &&
+         strcmp(entries.expansion(row), expansion) == 0;
+}
+
+int main()
+{
+  testDirectory("journal");
+
+  EntryTable base;
+  add(base, "brb", "be right back");
+  add(base, "teh", "the");
+  add(base, "omw", "on my way");
+
+  uint64_t checksum = 0;
+  CHECK(SaveFile::write(base, "config", &checksum));
+  CHECK(Journal::reset("journal", checksum));
+
+  std::vector<JournalOp> first  = {upsert(1, "teh", "the!"), upsert(3, "ty", "thank you")};
+  std::vector<JournalOp> second = {{JOURNAL_DELETE, 0, 0, "", ""}, upsert(2, "ty", "thanks")};
+  uint64_t firstBytes           = Journal::append("journal", first);
+  uint64_t secondBytes          = Journal::append("journal", second);
+  CHECK(firstBytes > 0);
+  CHECK(secondBytes > 0);
+  uint64_t whole = sizeof(JournalHeader) + firstBytes + secondBytes;
+  CHECK(std::filesystem::file_size("journal") == whole);
+
+  { // intact, every op applies in order
+    EntryTable entries;
+    uint64_t size = 0;
+    CHECK(SaveFile::read("config", &entries) == SAVE_FILE_LOADED);
+    CHECK(Journal::replay("journal", checksum, &entries, &size) == 4);
+    CHECK(size == whole);
+    CHECK(entries.size() == 3);
+    CHECK(hasRow(entries, 0, "teh", "the!"));
+    CHECK(hasRow(entries, 1, "omw", "on my way"));
+    CHECK(hasRow(entries, 2, "ty", "thanks"));
+  }
+
+  { // the crash hit halfway through the last record: it and only it is dropped, and the file is
+    // cut back so appending carries on after the last good one
+    std::filesystem::resize_file("journal", whole - 3);
+    EntryTable entries;
+    uint64_t size = 0;
+    CHECK(SaveFile::read("config", &entries) == SAVE_FILE_LOADED);
+    CHECK(Journal::replay("journal", checksum, &entries, &size) == 3);
+    CHECK(size < whole - 3);
+    CHECK(size > sizeof(JournalHeader) + firstBytes);
+    CHECK(std::filesystem::file_size("journal") == size);
+    CHECK(entries.size() == 3);
+    CHECK(hasRow(entries, 0, "teh", "the!"));
+    CHECK(hasRow(entries, 1, "omw", "on my way"));
+    CHECK(hasRow(entries, 2, "ty", "thank you"));
+
+    // checking only, nothing left to cut
+    uint64_t again = 0;
+    CHECK(Journal::replay("journal", checksum, nullptr, &again) == 3);
+    CHECK(again == size);
+  }
+
+  { // torn partway into the checksum, not even a whole record header left
+    std::filesystem::resize_file("journal", sizeof(JournalHeader) + firstBytes + 5);
+    uint64_t size = 0;
+    CHECK(Journal::replay("journal", checksum, nullptr, &size) == 2);
+    CHECK(size == sizeof(JournalHeader) + firstBytes);
+  }
+
+  { // compacted into a save file of the same size, then crashed before the journal was reset: the
+    // old journal no longer matches, whatever the file's size and timestamp say
+    EntryTable compacted;
+    add(compacted, "brb", "be right back");
+    add(compacted, "teh", "thx");
+    add(compacted, "omw", "on my way");
+    uint64_t newer = 0;
+    CHECK(SaveFile::write(compacted, "config", &newer));
+    CHECK(newer != checksum);
+
+    EntryTable entries;
+    uint64_t size = 0;
+    CHECK(SaveFile::read("config", &entries) == SAVE_FILE_LOADED);
+    CHECK(Journal::replay("journal", newer, &entries, &size) == -1);
+    CHECK(entries.size() == 3);
+    CHECK(hasRow(entries, 1, "teh", "thx"));
+  }
+
+  { // and no journal at all
+    uint64_t size = 0;
+    CHECK(Journal::replay("missing", checksum, nullptr, &size) == -1);
+  }
+
+  return testResult();
+}
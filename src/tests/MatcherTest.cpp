@@ -0,0 +1,250 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+// The pointer trie, the double array and the rolling hash are three ways of answering the same
+// question. Replaying one key trace through each must fire the same entries at the same keystrokes
+// and send the same keys.
+
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "AppData.hpp"
+#include "KeyTrace.hpp"
+#include "SaveFile.hpp"
+#include "Test.hpp"
+
+struct Run
+{
+  std::vector<int> fired; // entry per keystroke, -1 when nothing expanded
+  long long erased  = 0;
+  long long typed   = 0;
+  long long strokes = 0;
+  long long planned = 0;
+};
+
+// What a frame of the editor would do after init(): hand a pending rebuild to the builder, then
+// wait here until it has been published
+static void settle(AppData *data)
+{
+  if (!data->matcherDirty) { return; }
+
+  const MatcherSnapshot *loaded = nullptr;
+  {
+    SnapshotReader reader(&data->matcher);
+    loaded = reader.snapshot;
+  }
+  data->refreshMatcher();
+  for (int waited = 0; waited < 5000; waited++)
+  {
+    SnapshotReader reader(&data->matcher);
+    if (reader.snapshot != loaded) { return; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  fprintf(stderr, "the rebuild never got published\n");
+}
+
+static Run replay(MatcherEngine engine, const std::vector<KeyEvent> &events)
+{
+  RecordingSink sink;
+  AppData *data = new AppData();
+  data->engine  = engine;
+  data->keyMap  = std::make_shared<KeyMap>(sink.keyMap);
+  data->init();
+  settle(data);
+
+  Run run;
+  for (const KeyEvent &event : events)
+  {
+    run.fired.push_back(data->onKeyPress(event.pressed, &sink));
+  }
+  run.erased  = sink.erased;
+  run.typed   = sink.typed;
+  run.strokes = sink.strokes;
+  run.planned = sink.planned;
+
+  data->shutdown();
+  delete data;
+  return run;
+}
+
+static bool imageLoads()
+{
+  uint64_t size    = 0;
+  int64_t modified = 0;
+  if (!AppData::sourceStamp(&size, &modified)) { return false; }
+
+  MatcherSnapshot *image = MatcherImage::load(IMAGE_FILE_NAME, size, modified);
+  delete image;
+  return image != nullptr;
+}
+
+static bool writeSaveFile(const std::vector<std::pair<const char *, const char *>> &rows)
+{
+  EntryTable entries;
+  for (auto &row : rows)
+  {
+    entries.add((int)entries.size(), row.first, strlen(row.first), row.second, strlen(row.second), 0);
+  }
+  return SaveFile::write(entries, SAVE_FILE_NAME);
+}
+
+// Two rows that share a key, the earlier of them holding the higher id: a reload that swaps two
+// rows around, then an edit that gives the second one the first one's key. Whichever engine it
+// is, typing the key has to fire the lower row. Returns whether it did.
+static bool laterRowWins(MatcherEngine engine)
+{
+  testDirectory("matcher_duplicates");
+  CHECK(writeSaveFile({{"ty", "thank you"}, {"brb", "be right back"}}));
+
+  AppData *data = new AppData();
+  data->engine  = engine;
+  data->init();
+
+  // one row longer, so the file can't pass for the one we loaded whatever its timestamp
+  CHECK(writeSaveFile({{"brb", "be right back"}, {"ty", "thank you"}, {"omw", "on my way"}}));
+  data->reloadWanted = true;
+  for (int waited = 0; waited < 5000 && data->entries.size() != 3; waited++)
+  {
+    data->watchSaveFile();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(data->entries.size() == 3);
+  CHECK(data->entries.ids[0] > data->entries.ids[1]);
+
+  data->entries.setKey(1, "brb", 3);
+  data->updateEntry(1);
+  settle(data);
+
+  RecordingSink sink;
+  int fired = -1;
+  for (const char *c = "brb"; *c; c++)
+  {
+    fired = data->onKeyPress(*c, &sink);
+  }
+  bool wins = fired != -1 && fired == data->entries.ids[1];
+
+  data->shutdown();
+  delete data;
+  return wins;
+}
+
+// An image whose one entry has `flags`, with checksums that match, so only the flags are wrong
+static bool imageLoadsWithFlags(uint32_t flags)
+{
+  MatcherSnapshot snapshot;
+  snapshot.engine = ENGINE_DOUBLE_ARRAY;
+  snapshot.addEntry(0, "brb", "be right back", flags);
+  snapshot.compile();
+  if (!MatcherImage::write(snapshot, "flags.image", 1, 1)) { return false; }
+
+  MatcherSnapshot *image = MatcherImage::load("flags.image", 1, 1);
+  delete image;
+  return image != nullptr;
+}
+
+int main()
+{
+  testDirectory("matcher");
+
+  // keys inside keys, keys that end other keys, a shared prefix with the expansion, a duplicate
+  // where the later one wins, and one no engine can match
+  const char *pairs[][2] = {
+      {"he", "HE"},
+      {"she", "SHE"},
+      {"his", "HIS"},
+      {"hers", "HERS"},
+      {"teh", "the"},
+      {"brb", "be right back"},
+      {"addr", "address"},
+      {"ad", "advertisement"},
+      {"a;;", "a semicolon"},
+      {"brb", "be right back!"},
+      {"caf\xC3\xA9", "coffee"},
+      {"zz", "sleep\nwell"},
+  };
+  EntryTable entries;
+  for (auto &pair : pairs)
+  {
+    entries.add((int)entries.size(), pair[0], strlen(pair[0]), pair[1], strlen(pair[1]), 0);
+  }
+  CHECK(SaveFile::write(entries, SAVE_FILE_NAME));
+
+  const char *typed = "ushers teh brb, addr shehis hers ad a;; zz caf\xC3\xA9 thehe brbrb aaddr";
+  {
+    KeyTraceWriter writer;
+    CHECK(writer.open("session.trace"));
+    for (const char *c = typed; *c; c++)
+    {
+      writer.record(*c);
+      if (*c == ' ') { writer.record(KEY_MODIFIER_PRESSED); }
+    }
+    writer.record(KEY_SHIFT_RELEASED);
+  }
+
+  std::vector<KeyEvent> events;
+  {
+    KeyTraceReader reader;
+    CHECK(reader.open("session.trace"));
+    KeyEvent event;
+    while (reader.next(&event))
+    {
+      events.push_back(event);
+    }
+  }
+  CHECK(!events.empty());
+
+  Run trie       = replay(ENGINE_TRIE, events);
+  int expansions = 0;
+  for (int entry : trie.fired)
+  {
+    if (entry != -1) { expansions++; }
+  }
+  CHECK(expansions >= 10);
+  CHECK(trie.planned > 0);
+
+  // the first double array run leaves an image behind, the second starts from it
+  MatcherEngine others[] = {ENGINE_DOUBLE_ARRAY, ENGINE_ROLLING_HASH, ENGINE_DOUBLE_ARRAY};
+  for (int i = 0; i < 3; i++)
+  {
+    MatcherEngine engine = others[i];
+    if (i == 2) { CHECK(imageLoads()); }
+    Run other = replay(engine, events);
+    CHECK(other.fired == trie.fired);
+    CHECK(other.erased == trie.erased);
+    CHECK(other.typed == trie.typed);
+    CHECK(other.strokes == trie.strokes);
+    CHECK(other.planned == trie.planned);
+    if (other.fired != trie.fired) { fprintf(stderr, "%s disagrees with trie\n", engineName(engine)); }
+  }
+
+  MatcherEngine engines[] = {ENGINE_TRIE, ENGINE_DOUBLE_ARRAY, ENGINE_ROLLING_HASH};
+  for (MatcherEngine engine : engines)
+  {
+    bool wins = laterRowWins(engine);
+    CHECK(wins);
+    if (!wins) { fprintf(stderr, "%s fired the wrong one of two rows with the same key\n", engineName(engine)); }
+  }
+
+  // a stored expansion would be read through a store the image doesn't have
+  CHECK(imageLoadsWithFlags(SNAPSHOT_ENTRY_PASTE | SNAPSHOT_ENTRY_MULTILINE));
+  CHECK(!imageLoadsWithFlags(SNAPSHOT_ENTRY_STORED));
+  CHECK(!imageLoadsWithFlags(1u << 7));
+
+  return testResult();
+}
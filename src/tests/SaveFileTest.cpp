@@ -0,0 +1,154 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+// Binary save files going out and coming back in, eagerly and with lazy bodies, and what happens
+// to ones that got damaged or cut short on the way.
+
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "EntryTable.hpp"
+#include "SaveFile.hpp"
+#include "Test.hpp"
+
+static void add(EntryTable &entries, const char *key, const char *expansion, uint8_t flags)
+{
+  entries.add((int)entries.size(), key, strlen(key), expansion, strlen(expansion), flags);
+}
+
+static bool same(const EntryTable &a, const EntryTable &b)
+{
+  if (a.size() != b.size()) { return false; }
+  for (int row = 0; row < (int)a.size(); row++)
+  {
+    if (a.flags[row] != b.flags[row] || a.keys[row].length != b.keys[row].length ||
+        a.expansions[row].length != b.expansions[row].length ||
+        memcmp(a.key(row), b.key(row), a.keys[row].length) != 0 ||
+        memcmp(a.expansion(row), b.expansion(row), a.expansions[row].length) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string readAll(const char *path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static void writeAll(const char *path, const std::string &bytes)
+{
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), bytes.size());
+}
+
+int main()
+{
+  testDirectory("save_file");
+
+  EntryTable entries;
+  add(entries, "addr", "123 Fake Street", 0);
+  add(entries, "sig", "Kind regards,\nJake", ENTRY_MULTILINE);
+  add(entries, "pw", "hunter2", ENTRY_HIDDEN);
+  add(entries, "cafe", "caf\xC3\xA9 \xE2\x98\x95", ENTRY_PASTE);
+  add(entries, "empty", "", 0);
+  add(entries, "addr", "a duplicate key, kept in order", ENTRY_HIDDEN | ENTRY_PASTE);
+
+  uint64_t written = 0;
+  CHECK(SaveFile::write(entries, "config", &written));
+
+  uint64_t trailer = 0;
+  CHECK(SaveFile::readChecksum("config", &trailer));
+  CHECK(trailer == written);
+
+  { // eager round trip
+    EntryTable read;
+    CHECK(SaveFile::read("config", &read) == SAVE_FILE_LOADED);
+    CHECK(same(entries, read));
+  }
+
+  { // lazy round trip, expansions come out of the mapped file
+    EntryTable read;
+    CHECK(SaveFile::read("config", &read, true) == SAVE_FILE_LOADED);
+    CHECK(same(entries, read));
+    CHECK(read.store != nullptr);
+    for (int row = 0; row < (int)read.size(); row++)
+    {
+      CHECK(read.stored[row]);
+    }
+  }
+
+  { // an empty dictionary is still a valid file
+    EntryTable none;
+    EntryTable read;
+    CHECK(SaveFile::write(none, "empty"));
+    CHECK(SaveFile::read("empty", &read) == SAVE_FILE_LOADED);
+    CHECK(read.size() == 0);
+  }
+
+  CHECK(SaveFile::read("missing", &entries) == SAVE_FILE_MISSING);
+
+  std::string bytes = readAll("config");
+
+  { // one flipped bit in an expansion: the checksum catches it, a lazy load doesn't look
+    std::string corrupt = bytes;
+    corrupt[corrupt.size() - sizeof(uint64_t) - 3] ^= 1;
+    writeAll("corrupt", corrupt);
+
+    EntryTable read;
+    add(read, "keep", "me", 0);
+    CHECK(SaveFile::read("corrupt", &read) == SAVE_FILE_CORRUPT);
+    CHECK(read.size() == 1); // left as it was
+
+    EntryTable lazy;
+    CHECK(SaveFile::read("corrupt", &lazy, true) == SAVE_FILE_LOADED);
+  }
+
+  { // a header whose sections don't add up is caught either way
+    std::string corrupt = bytes;
+    SaveFileHeader header;
+    memcpy(&header, corrupt.data(), sizeof(header));
+    header.keysSize += 8;
+    memcpy(&corrupt[0], &header, sizeof(header));
+    writeAll("sections", corrupt);
+
+    EntryTable read;
+    CHECK(SaveFile::read("sections", &read) == SAVE_FILE_CORRUPT);
+    CHECK(SaveFile::read("sections", &read, true) == SAVE_FILE_CORRUPT);
+    CHECK(read.size() == 0);
+  }
+
+  // cut short anywhere, from inside the header to just the last byte of the checksum
+  size_t cuts[] = {4, sizeof(SaveFileHeader) - 1, sizeof(SaveFileHeader) + 3, bytes.size() / 2, bytes.size() - 1};
+  for (size_t cut : cuts)
+  {
+    writeAll("truncated", bytes.substr(0, cut));
+    EntryTable read;
+    SaveFileStatus eager = SaveFile::read("truncated", &read);
+    SaveFileStatus lazy  = SaveFile::read("truncated", &read, true);
+
+    // too short for the magic, it might as well be an old text file
+    SaveFileStatus expected = cut < sizeof(ABBRV_SAVE_MAGIC) - 1 ? SAVE_FILE_OLDER_FORMAT : SAVE_FILE_CORRUPT;
+    CHECK(eager == expected);
+    CHECK(lazy == expected);
+    CHECK(read.size() == 0);
+  }
+
+  return testResult();
+}
@@ -0,0 +1,55 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+#pragma once
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <stdio.h>
+
+#include <filesystem>
+#include <string>
+
+// Just enough of a harness for the core's ctest targets. A failed CHECK is reported and the test
+// carries on, so one run shows everything that's broken; main() returns testResult().
+inline int testFailures = 0;
+
+#define CHECK(condition)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(condition))                                                                                                  \
+    {                                                                                                                  \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);                                    \
+      testFailures++;                                                                                                  \
+    }                                                                                                                  \
+  } while (0)
+
+inline int testResult()
+{
+  if (testFailures > 0) { fprintf(stderr, "%d checks failed\n", testFailures); }
+  return testFailures > 0 ? 1 : 0;
+}
+
+// An empty directory of our own under the system temp directory, made the working directory so
+// the relative file names the app uses (SAVE_FILE_NAME and friends) land in it
+inline std::filesystem::path testDirectory(const char *name)
+{
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / (std::string("abbrv_") + name);
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::filesystem::current_path(directory);
+  return directory;
+}
+
+#endif
@@ -0,0 +1,487 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+/*
+ * Microbenchmark for the keystroke path. For every dictionary size and engine it generates a
+ * synthetic dictionary, compiles a snapshot the same way the app does and replays a keystroke
+ * stream through MatcherSnapshot::advance, which is all the keyboard hook does per key.
+ * Results are printed as one JSON document on stdout so they can be diffed between versions:
+ *
+ *   abbrv_benchmark --sizes 100,10000,1000000 --keystrokes 2000000 > results.json
+ *   abbrv_benchmark --input session.txt
+ *
+ * Latency percentiles come from timing each keystroke on its own, so they include the cost of
+ * reading the clock (reported as timer_overhead_ns). ns_per_keystroke is timed over the whole
+ * stream and doesn't. bytes_per_key is index_bytes spread over the distinct keys the engine holds.
+ *
+ * Each dictionary size is also written out as a save file in both formats, and loading each one
+ * back is reported as save_files, in MB of file parsed per second. lazy_load_ms is the binary one
+ * again with lazy bodies, which only reads the keys.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Debug.hpp"
+#include "Matcher.hpp"
+#include "SaveFile.hpp"
+#include "Trie.hpp"
+
+// Every heap allocation in the process goes through here so we can tell if the hot path ever
+// allocates. It shouldn't.
+static std::atomic<long long> allocations{0};
+
+void *operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void *memory = malloc(size ? size : 1);
+  if (memory == nullptr) { throw std::bad_alloc(); }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+  std::vector<int> sizes             = {100, 1000, 10000, 100000, 1000000};
+  std::vector<MatcherEngine> engines = {ENGINE_DOUBLE_ARRAY, ENGINE_TRIE, ENGINE_ROLLING_HASH};
+  long long keystrokes               = 1000000;
+  int maxTrieEntries                 = 10000; // ~1KB per trie node, 100k entries is close to a gigabyte
+  unsigned int seed                  = 1;
+  const char *input                  = nullptr;
+  bool longKeys                      = false;
+};
+
+struct Result
+{
+  MatcherEngine engine;
+  int entries;
+  int keys;
+  long long keystrokes;
+  long long expansions;
+  double buildMs;
+  double nsPerKeystroke;
+  double p50;
+  double p99;
+  double p999;
+  double allocationsPerKeystroke;
+  size_t indexBytes;
+};
+
+struct SaveResult
+{
+  int entries;
+  size_t textBytes;
+  size_t binaryBytes;
+  double textMBps;
+  double binaryMBps;
+  double lazyMs;
+};
+
+enum SaveFileLoad
+{
+  LOAD_TEXT,
+  LOAD_BINARY,
+  LOAD_LAZY,
+};
+
+// Syllables keep the generated keys pronounceable-ish and, more importantly, make lots of them
+// share prefixes the way real abbreviation lists do.
+static const char *SYLLABLES[] = {"a",  "ad", "al", "an", "ar", "be", "bo", "ca", "ce", "co", "da", "de", "di",
+                                  "do", "e",  "el", "em", "en", "er", "ex", "fa", "fi", "fo", "ga", "go", "ha",
+                                  "he", "hi", "i",  "in", "is", "it", "ja", "ka", "la", "le", "li", "lo", "ma",
+                                  "me", "mi", "mo", "na", "ne", "no", "o",  "on", "or", "pa", "pe", "po", "ra",
+                                  "re", "ri", "ro", "sa", "se", "si", "so", "ta", "te", "ti", "to", "u"};
+static const int SYLLABLE_COUNT = sizeof(SYLLABLES) / sizeof(SYLLABLES[0]);
+
+static std::string randomWord(std::mt19937 &rng, int minSyllables, int maxSyllables)
+{
+  std::string word;
+  int count = minSyllables + (int)(rng() % (maxSyllables - minSyllables + 1));
+  for (int i = 0; i < count; i++)
+  {
+    word += SYLLABLES[rng() % SYLLABLE_COUNT];
+  }
+  return word;
+}
+
+// Most people namespace their abbreviations behind ";;", some use a different sigil and a few
+// just use bare words as autocorrect. About a fifth of the keys extend an earlier key (";;sig"
+// and ";;sig2"), which is the overlap that makes the fail links matter. --long-keys instead
+// makes every key a long one behind the same long prefix, the rolling hash engine's best case.
+static std::vector<std::string> generateKeys(int count, bool longKeys, std::mt19937 &rng)
+{
+  std::vector<std::string> keys;
+  std::unordered_set<std::string> seen;
+  keys.reserve(count);
+  seen.reserve(count);
+
+  while ((int)keys.size() < count)
+  {
+    std::string key;
+    int kind = rng() % 100;
+    if (longKeys) { key = ";;acme-support-reply-" + randomWord(rng, 2, 8); }
+    else if (kind < 20 && !keys.empty())
+    {
+      key = keys[rng() % keys.size()];
+      key += rng() % 2 ? std::to_string(rng() % 10) : randomWord(rng, 1, 1);
+    }
+    else if (kind < 85) { key = ";;" + randomWord(rng, 1, 4); }
+    else if (kind < 95) { key = "//" + randomWord(rng, 1, 3); }
+    else { key = randomWord(rng, 2, 4); }
+
+    if (seen.insert(key).second) { keys.push_back(key); }
+  }
+  return keys;
+}
+
+// Prose made from the same syllables, with a dictionary key dropped in every so often
+static std::string generateStream(long long length, const std::vector<std::string> &keys, std::mt19937 &rng)
+{
+  std::string stream;
+  stream.reserve(length + 64);
+  while ((long long)stream.size() < length)
+  {
+    if (rng() % 20 == 0) { stream += keys[rng() % keys.size()]; }
+    else { stream += randomWord(rng, 1, 3); }
+    stream += rng() % 10 == 0 ? ". " : " ";
+  }
+  stream.resize(length);
+  return stream;
+}
+
+static MatcherSnapshot *buildSnapshot(MatcherEngine engine, const std::vector<std::string> &keys)
+{
+  MatcherSnapshot *snapshot = new MatcherSnapshot();
+  snapshot->engine          = engine;
+  for (int id = 0; id < (int)keys.size(); id++)
+  {
+    std::string expansion = "expansion of " + keys[id];
+    snapshot->addEntry(id, keys[id].c_str(), expansion.c_str(), 0);
+  }
+
+  if (engine == ENGINE_TRIE)
+  {
+    size_t keyCharacters = 0;
+    for (int id = 0; id < (int)keys.size(); id++)
+    {
+      keyCharacters += keys[id].size();
+    }
+    snapshot->nodes.reserve(keyCharacters + 1);
+    snapshot->root = TrieNode::getNode(snapshot->nodes);
+    for (int id = 0; id < (int)keys.size(); id++)
+    {
+      TrieNode *node = TrieNode::insert(snapshot->nodes, snapshot->root, keys[id].c_str());
+      if (node == nullptr) { continue; }
+      node->terminal = true;
+      node->entry    = id;
+    }
+  }
+
+  snapshot->compile();
+  return snapshot;
+}
+
+static double percentile(std::vector<uint32_t> &samples, double fraction)
+{
+  if (samples.empty()) { return 0.0; }
+  size_t index = std::min(samples.size() - 1, (size_t)(fraction * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+static double timerOverhead()
+{
+  const int rounds        = 100000;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < rounds; i++)
+  {
+    Clock::now();
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / rounds;
+}
+
+static Result run(MatcherEngine engine, int size, const std::string *recorded, const Options &options)
+{
+  std::mt19937 rng(options.seed + size);
+  std::vector<std::string> keys = generateKeys(size, options.longKeys, rng);
+  std::string stream            = recorded ? *recorded : generateStream(options.keystrokes, keys, rng);
+
+  Clock::time_point buildStart = Clock::now();
+  MatcherSnapshot *snapshot    = buildSnapshot(engine, keys);
+  Clock::time_point buildEnd   = Clock::now();
+
+  Result result     = {};
+  result.engine     = engine;
+  result.entries    = size;
+  result.keys       = size;
+  if (engine == ENGINE_DOUBLE_ARRAY) { result.keys = snapshot->compact.keyCount; }
+  if (engine == ENGINE_ROLLING_HASH) { result.keys = snapshot->hashed.keyCount; }
+  result.keystrokes = (long long)stream.size();
+  result.indexBytes = snapshot->indexBytes();
+  result.buildMs    = std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+
+  std::vector<uint32_t> samples(stream.size());
+  long long allocationsBefore = allocations.load();
+
+  // throughput, which also warms the caches for the latency pass
+  MatchCursor cursor;
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < stream.size(); i++)
+  {
+    if (snapshot->advance(cursor, stream[i]) != -1) { result.expansions++; }
+  }
+  Clock::time_point end = Clock::now();
+  double elapsed        = std::chrono::duration<double, std::nano>(end - start).count();
+  result.nsPerKeystroke = elapsed / std::max<size_t>(1, stream.size());
+
+  // the expansions are counted again so the optimizer can't throw the whole pass away
+  cursor             = MatchCursor();
+  long long repeated = 0;
+  for (size_t i = 0; i < stream.size(); i++)
+  {
+    Clock::time_point before = Clock::now();
+    if (snapshot->advance(cursor, stream[i]) != -1) { repeated++; }
+    samples[i] = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count();
+  }
+  if (repeated != result.expansions)
+  {
+    WARN("The latency pass saw %lld expansions, expected %lld", repeated, result.expansions);
+  }
+
+  long long allocated            = allocations.load() - allocationsBefore;
+  result.allocationsPerKeystroke = (double)allocated / std::max<size_t>(1, 2 * stream.size());
+  result.p50                     = percentile(samples, 0.50);
+  result.p99                     = percentile(samples, 0.99);
+  result.p999                    = percentile(samples, 0.999);
+
+  delete snapshot;
+  return result;
+}
+
+// Best of a few loads, in seconds
+static double loadTime(const char *path, SaveFileLoad load, int entries)
+{
+  double best = 0.0;
+  for (int round = 0; round < 3; round++)
+  {
+    EntryTable table;
+    Clock::time_point start = Clock::now();
+    bool loaded             = load == LOAD_TEXT ? SaveFile::readText(path, &table) :
+                                                  SaveFile::read(path, &table, load == LOAD_LAZY) == SAVE_FILE_LOADED;
+    double seconds          = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!loaded || (int)table.size() != entries)
+    {
+      WARN("Loading %s gave %zu entries, expected %d", path, table.size(), entries);
+      return 0.0;
+    }
+    best = round == 0 ? seconds : std::min(best, seconds);
+  }
+  return best;
+}
+
+static SaveResult runSaveFiles(int size, const Options &options)
+{
+  std::mt19937 rng(options.seed + size);
+  std::vector<std::string> keys = generateKeys(size, options.longKeys, rng);
+
+  // expansions a sentence or two long, with the odd multi-line one
+  EntryTable table;
+  table.reserve(keys.size());
+  for (int i = 0; i < (int)keys.size(); i++)
+  {
+    std::string expansion;
+    int words = 5 + (int)(rng() % 30);
+    for (int w = 0; w < words; w++)
+    {
+      expansion += randomWord(rng, 1, 3);
+      expansion += rng() % 12 == 0 ? "\n" : " ";
+    }
+    table.add(-1, keys[i].data(), keys[i].size(), expansion.data(), expansion.size(),
+              expansion.find('\n') != std::string::npos ? ENTRY_MULTILINE : 0);
+  }
+
+  std::filesystem::path directory = std::filesystem::temp_directory_path();
+  std::string textPath            = (directory / "abbrv_benchmark.txt").string();
+  std::string binaryPath          = (directory / "abbrv_benchmark.abbrv").string();
+  SaveFile::writeText(table, textPath.c_str());
+  SaveFile::write(table, binaryPath.c_str());
+
+  SaveResult result  = {};
+  result.entries     = size;
+  result.textBytes   = std::filesystem::file_size(textPath);
+  result.binaryBytes = std::filesystem::file_size(binaryPath);
+  result.textMBps    = result.textBytes / 1e6 / loadTime(textPath.c_str(), LOAD_TEXT, size);
+  result.binaryMBps  = result.binaryBytes / 1e6 / loadTime(binaryPath.c_str(), LOAD_BINARY, size);
+  result.lazyMs      = 1000.0 * loadTime(binaryPath.c_str(), LOAD_LAZY, size);
+
+  std::filesystem::remove(textPath);
+  std::filesystem::remove(binaryPath);
+  return result;
+}
+
+static bool parseSizes(const char *list, std::vector<int> *sizes)
+{
+  sizes->clear();
+  for (const char *c = list; *c;)
+  {
+    char *end = nullptr;
+    long size = strtol(c, &end, 10);
+    if (end == c || size <= 0) { return false; }
+    sizes->push_back((int)size);
+    c = *end == ',' ? end + 1 : end;
+  }
+  return !sizes->empty();
+}
+
+static void printUsage()
+{
+  printf("usage: abbrv_benchmark [--sizes n,n,...] [--engine <engine>|all] [--keystrokes n]\n");
+  printf("                       [--max-trie-entries n] [--seed n] [--input <file>] [--long-keys]\n");
+  printf("  --sizes             dictionary sizes to generate, defaults to 100,1000,10000,100000,1000000\n");
+  printf("  --engine            trie, double-array, rolling-hash or all, defaults to all\n");
+  printf("  --keystrokes        length of the synthetic keystroke stream, defaults to 1000000\n");
+  printf("  --max-trie-entries  skip the pointer trie above this many entries, defaults to 10000\n");
+  printf("  --seed              seed for the dictionaries and streams, defaults to 1\n");
+  printf("  --input             replay the characters of this file instead of a synthetic stream\n");
+  printf("  --long-keys         generate long keys that all share a long prefix\n");
+}
+
+int main(int argc, char *args[])
+{
+  // stdout is reserved for the JSON
+  Debug::output = stderr;
+
+  Options options;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = args[i];
+    bool hasValue   = i + 1 < argc;
+    if (arg == "--sizes" && hasValue)
+    {
+      if (!parseSizes(args[++i], &options.sizes))
+      {
+        fprintf(stderr, "Bad size list %s\n", args[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--engine" && hasValue)
+    {
+      MatcherEngine engine;
+      if (parseEngine(args[++i], &engine)) { options.engines = {engine}; }
+      else if (strcmp(args[i], "all") != 0)
+      {
+        fprintf(stderr, "Unknown engine %s\n", args[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--keystrokes" && hasValue) { options.keystrokes = atoll(args[++i]); }
+    else if (arg == "--max-trie-entries" && hasValue) { options.maxTrieEntries = atoi(args[++i]); }
+    else if (arg == "--seed" && hasValue) { options.seed = (unsigned int)strtoul(args[++i], nullptr, 10); }
+    else if (arg == "--input" && hasValue) { options.input = args[++i]; }
+    else if (arg == "--long-keys") { options.longKeys = true; }
+    else
+    {
+      printUsage();
+      return arg == "--help" ? 0 : 1;
+    }
+  }
+
+  std::string recorded;
+  if (options.input != nullptr)
+  {
+    FILE *in = fopen(options.input, "rb");
+    if (in == nullptr)
+    {
+      fprintf(stderr, "Can't open %s\n", options.input);
+      return 1;
+    }
+    char buffer[64 * 1024];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+      recorded.append(buffer, read);
+    }
+    fclose(in);
+  }
+
+  double overhead = timerOverhead();
+  std::vector<Result> results;
+  for (int s = 0; s < (int)options.sizes.size(); s++)
+  {
+    for (int e = 0; e < (int)options.engines.size(); e++)
+    {
+      MatcherEngine engine = options.engines[e];
+      if (engine == ENGINE_TRIE && options.sizes[s] > options.maxTrieEntries)
+      {
+        fprintf(stderr, "Skipping the trie engine at %d entries, see --max-trie-entries\n", options.sizes[s]);
+        continue;
+      }
+      fprintf(stderr, "Running %s with %d entries\n", engineName(engine), options.sizes[s]);
+      results.push_back(run(engine, options.sizes[s], options.input ? &recorded : nullptr, options));
+    }
+  }
+
+  std::vector<SaveResult> saveResults;
+  for (int s = 0; s < (int)options.sizes.size(); s++)
+  {
+    fprintf(stderr, "Loading save files with %d entries\n", options.sizes[s]);
+    saveResults.push_back(runSaveFiles(options.sizes[s], options));
+  }
+
+  printf("{\n");
+  printf("  \"benchmark\": \"keystroke_matcher\",\n");
+  printf("  \"seed\": %u,\n", options.seed);
+  printf("  \"stream\": \"%s\",\n", options.input ? "recorded" : "synthetic");
+  printf("  \"keys\": \"%s\",\n", options.longKeys ? "long" : "mixed");
+  printf("  \"timer_overhead_ns\": %.1f,\n", overhead);
+  printf("  \"results\": [\n");
+  for (int i = 0; i < (int)results.size(); i++)
+  {
+    const Result &r = results[i];
+    printf("    {\"engine\": \"%s\", \"entries\": %d, \"keys\": %d, \"keystrokes\": %lld, \"expansions\": %lld, "
+           "\"build_ms\": %.3f, \"ns_per_keystroke\": %.2f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f, "
+           "\"allocations_per_keystroke\": %.4f, \"index_bytes\": %zu, \"bytes_per_key\": %.1f}%s\n",
+           engineName(r.engine), r.entries, r.keys, r.keystrokes, r.expansions,
+           r.buildMs, r.nsPerKeystroke, r.p50, r.p99, r.p999, r.allocationsPerKeystroke, r.indexBytes,
+           r.keys > 0 ? (double)r.indexBytes / r.keys : 0.0, i + 1 < (int)results.size() ? "," : "");
+  }
+  printf("  ],\n");
+  printf("  \"save_files\": [\n");
+  for (int i = 0; i < (int)saveResults.size(); i++)
+  {
+    const SaveResult &r = saveResults[i];
+    printf("    {\"entries\": %d, \"text_bytes\": %zu, \"text_parse_mb_per_s\": %.1f, \"binary_bytes\": %zu, "
+           "\"binary_load_mb_per_s\": %.1f, \"lazy_load_ms\": %.3f}%s\n",
+           r.entries, r.textBytes, r.textMBps, r.binaryBytes, r.binaryMBps, r.lazyMs,
+           i + 1 < (int)saveResults.size() ? "," : "");
+  }
+  printf("  ]\n");
+  printf("}\n");
+  return 0;
+}
@@ -0,0 +1,254 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+/*
+ * abbrv without the window or the keyboard hook. Loads a config exactly like the app does and
+ * pushes keystrokes through the same matcher the hook uses, printing every expansion that fires.
+ * Handy for profiling the hot path on a machine that can't run the GUI:
+ *
+ *   abbrv_headless --config ~/abbrv --input keystrokes.txt
+ *   echo "hello ;;sig" | abbrv_headless
+ *
+ * With --record it also writes what it read to a key trace for abbrv_replay. Input arrives a
+ * chunk at a time, so the timestamps are only as good as the terminal or pipe feeding us.
+ *
+ * --import and --export move the whole dictionary in or out of CSV, TSV or JSON and exit, which is
+ * how a big shared dictionary gets loaded without the GUI:
+ *
+ *   abbrv_headless --config ~/abbrv --import corporate.tsv
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "AppData.hpp"
+#include "BulkIO.hpp"
+#include "Debug.hpp"
+#include "KeyTrace.hpp"
+#include "Matcher.hpp"
+
+// Migrating a big old config can take a while, say so on stderr where it won't mix with expansions
+static void printMigration(size_t done, size_t total)
+{
+  fprintf(stderr, "\rUpdating the save file, %3d%%", (int)(100.0 * done / (total > 0 ? total : 1)));
+  if (done == total) { fprintf(stderr, "\n"); }
+}
+
+static void printUsage()
+{
+  printf("usage: abbrv_headless [--config <directory>] [--engine <engine>] [--input <file>]\n");
+  printf("                      [--record <file>] [--export-text <file>] [--import <file>] [--export <file>]\n");
+  printf("                      [--format <format>] [--lazy-bodies] [--quiet]\n");
+  printf("  --config       directory holding " SAVE_FILE_NAME ", defaults to the current directory\n");
+  printf("  --engine       matcher to run the keystrokes through, trie, double-array or rolling-hash,\n");
+  printf("                 defaults to double-array\n");
+  printf("  --input        file to read keystrokes from, defaults to stdin\n");
+  printf("  --record       also write the keystrokes to a key trace\n");
+  printf("  --export-text  write the entries out in the old text format and exit\n");
+  printf("  --import       merge the rows of a CSV, TSV or JSON file into the config and exit\n");
+  printf("  --export       write the entries out as CSV, TSV or JSON and exit\n");
+  printf("  --format       csv, tsv or json, for --import and --export, defaults to the file's extension\n");
+  printf("  --lazy-bodies  leave expansions in the save file until they're expanded\n");
+  printf("  --quiet        only print the summary\n");
+}
+
+int main(int argc, char *args[])
+{
+  // keep the log out of the expansions we print
+  Debug::output = stderr;
+
+  const char *configDirectory = nullptr;
+  const char *inputPath       = nullptr;
+  const char *tracePath       = nullptr;
+  std::string exportPath;
+  std::string bulkImportPath;
+  std::string bulkExportPath;
+  BulkFormat format           = BULK_UNKNOWN;
+  MatcherEngine engine        = ENGINE_DOUBLE_ARRAY;
+  bool quiet                  = false;
+  bool lazyBodies             = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = args[i];
+    bool hasValue   = i + 1 < argc;
+    if (arg == "--config" && hasValue) { configDirectory = args[++i]; }
+    else if (arg == "--input" && hasValue) { inputPath = args[++i]; }
+    else if (arg == "--record" && hasValue) { tracePath = args[++i]; }
+    else if (arg == "--export-text" && hasValue) { exportPath = std::filesystem::absolute(args[++i]).string(); }
+    else if (arg == "--import" && hasValue) { bulkImportPath = std::filesystem::absolute(args[++i]).string(); }
+    else if (arg == "--export" && hasValue) { bulkExportPath = std::filesystem::absolute(args[++i]).string(); }
+    else if (arg == "--format" && hasValue)
+    {
+      if (!BulkIO::parseFormat(args[++i], &format))
+      {
+        fprintf(stderr, "Unknown format %s\n", args[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--engine" && hasValue)
+    {
+      if (!parseEngine(args[++i], &engine))
+      {
+        fprintf(stderr, "Unknown engine %s\n", args[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--quiet") { quiet = true; }
+    else if (arg == "--lazy-bodies") { lazyBodies = true; }
+    else
+    {
+      printUsage();
+      return arg == "--help" ? 0 : 1;
+    }
+  }
+
+  // AppData reads and writes its files relative to the working directory, same as the app
+  if (configDirectory != nullptr)
+  {
+    std::error_code error;
+    std::filesystem::current_path(configDirectory, error);
+    if (error)
+    {
+      fprintf(stderr, "Can't use %s: %s\n", configDirectory, error.message().c_str());
+      return 1;
+    }
+  }
+
+  FILE *input = stdin;
+  if (inputPath != nullptr)
+  {
+    input = fopen(inputPath, "rb");
+    if (input == nullptr)
+    {
+      fprintf(stderr, "Can't open %s\n", inputPath);
+      return 1;
+    }
+  }
+
+  KeyTraceWriter trace;
+  if (tracePath != nullptr && !trace.open(tracePath))
+  {
+    fprintf(stderr, "Can't write %s\n", tracePath);
+    return 1;
+  }
+
+  using Clock = std::chrono::steady_clock;
+
+  AppData *data           = new AppData();
+  data->engine            = engine;
+  data->lazyBodies        = lazyBodies;
+  data->migrationProgress = printMigration;
+  Clock::time_point t0    = Clock::now();
+  data->init();
+  Clock::time_point t1 = Clock::now();
+
+  if (!exportPath.empty())
+  {
+    bool exported = data->exportText(exportPath.c_str());
+    size_t count  = data->entries.size();
+    data->shutdown();
+    delete data;
+    if (!exported)
+    {
+      fprintf(stderr, "Can't write %s\n", exportPath.c_str());
+      return 1;
+    }
+    printf("Exported %zu entries to %s\n", count, exportPath.c_str());
+    return 0;
+  }
+
+  if (!bulkImportPath.empty() || !bulkExportPath.empty())
+  {
+    bool importing   = !bulkImportPath.empty();
+    std::string path = importing ? bulkImportPath : bulkExportPath;
+    if (format == BULK_UNKNOWN) { format = BulkIO::formatOf(path.c_str()); }
+
+    BulkStats stats;
+    bool done = importing ? data->importFile(path.c_str(), format, &stats)
+                          : data->exportFile(path.c_str(), format, &stats);
+    size_t count = data->entries.size();
+    data->shutdown(); // an import is only on disk once this returns
+    delete data;
+    if (!done)
+    {
+      if (format == BULK_UNKNOWN) { fprintf(stderr, "Can't tell the format of %s, use --format\n", path.c_str()); }
+      else if (stats.errorLine > 0) { fprintf(stderr, "Can't read %s past line %zu\n", path.c_str(), stats.errorLine); }
+      else { fprintf(stderr, "Can't %s %s\n", importing ? "read" : "write", path.c_str()); }
+      return 1;
+    }
+
+    printf("%s %zu rows %s %s\n", importing ? "Imported" : "Exported", stats.rows, importing ? "from" : "to",
+           path.c_str());
+    if (importing)
+    {
+      printf("added:         %zu\n", stats.added);
+      printf("updated:       %zu\n", stats.updated);
+      printf("unchanged:     %zu\n", stats.unchanged);
+      printf("duplicates:    %zu\n", stats.duplicates);
+      printf("skipped:       %zu\n", stats.skipped);
+      printf("entries:       %zu\n", count);
+    }
+    printf("time:          %.3f ms\n", stats.seconds * 1000);
+    printf("rows/s:        %.0f\n", stats.rowsPerSecond());
+    return 0;
+  }
+
+  long long keystrokes = 0;
+  long long matches    = 0;
+  Clock::duration matching{};
+  char buffer[64 * 1024];
+  size_t read = 0;
+  while ((read = fread(buffer, 1, sizeof(buffer), input)) > 0)
+  {
+    for (size_t i = 0; i < read && trace.isOpen(); i++)
+    {
+      trace.record(buffer[i]);
+    }
+    trace.writeBuffered();
+
+    // timed per chunk, so this includes printing the expansions unless we're --quiet
+    Clock::time_point start = Clock::now();
+    SnapshotReader reader(&data->matcher);
+    for (size_t i = 0; i < read; i++)
+    {
+      int entry = reader.snapshot->advance(data->cursor, buffer[i]);
+      if (entry == -1) { continue; }
+      matches++;
+      if (!quiet) { printf("%s -> %s\n", reader.snapshot->key(entry), reader.snapshot->expansion(entry)); }
+    }
+    matching += Clock::now() - start;
+    keystrokes += read;
+  }
+  if (input != stdin) { fclose(input); }
+  trace.close();
+
+  double loadMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  double ns     = std::chrono::duration<double, std::nano>(matching).count();
+  printf("entries:       %zu\n", data->entries.size());
+  printf("engine:        %s\n", engineName(engine));
+  printf("index bytes:   %zu\n", data->indexBytes());
+  printf("load:          %.3f ms\n", loadMs);
+  printf("keystrokes:    %lld\n", keystrokes);
+  printf("expansions:    %lld\n", matches);
+  printf("ns/keystroke:  %.1f\n", keystrokes ? ns / keystrokes : 0.0);
+
+  data->shutdown();
+  delete data;
+  return 0;
+}
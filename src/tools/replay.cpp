@@ -0,0 +1,196 @@
+/**
+ * abbrv Source Code
+ * Copyright (C) 2022 Jake Mason
+ *
+ * @version 1.6
+ * @author Jake Mason
+ * @date 10-17-2026
+ *
+ * abbrv is licensed under the Creative Commons
+ * Attribution-NonCommercial-ShareAlike 4.0 International License
+ *
+ * See LICENSE.txt for more information
+ **/
+
+/*
+ * Replays a key trace recorded by `abbrv --record-keys <file>` (or abbrv_headless --record)
+ * through AppData::onKeyPress, the same path the keyboard hook takes, with a RecordingSink
+ * standing in for SendInput. Prints one JSON document on stdout:
+ *
+ *   abbrv_replay --config ~/abbrv --trace monday.trace > monday.json
+ *
+ * Latencies are per keystroke, from the hook handing us the character to the sink receiving
+ * the expansion, and include the cost of reading the clock.
+ */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "AppData.hpp"
+#include "BulkIO.hpp"
+#include "Debug.hpp"
+#include "Injection.hpp"
+#include "KeyTrace.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double percentile(std::vector<uint32_t> &samples, double fraction)
+{
+  if (samples.empty()) { return 0.0; }
+  size_t index = std::min(samples.size() - 1, (size_t)(fraction * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+static void printUsage()
+{
+  printf("usage: abbrv_replay --trace <file> [--config <directory>] [--engine <engine>] [--repeat n]\n");
+  printf("                    [--paste-above n] [--unicode-input]\n");
+  printf("  --trace          key trace to replay\n");
+  printf("  --config         directory holding " SAVE_FILE_NAME ", defaults to the current directory\n");
+  printf("  --engine         matcher to replay through, trie, double-array or rolling-hash,\n");
+  printf("                   defaults to double-array\n");
+  printf("  --repeat         replay the trace this many times back to back, defaults to 1\n");
+  printf("  --paste-above    paste expansions longer than this many characters instead of typing them,\n");
+  printf("                   defaults to %d, 0 to only paste entries marked for it\n", PASTE_ABOVE_CHARACTERS);
+  printf("  --unicode-input  count keystrokes for typing text as Unicode rather than layout keys\n");
+}
+
+int main(int argc, char *args[])
+{
+  // stdout is reserved for the JSON
+  Debug::output = stderr;
+
+  const char *tracePath       = nullptr;
+  const char *configDirectory = nullptr;
+  MatcherEngine engine        = ENGINE_DOUBLE_ARRAY;
+  int repeat                  = 1;
+  size_t pasteAbove           = PASTE_ABOVE_CHARACTERS;
+  bool unicodeInput           = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = args[i];
+    bool hasValue   = i + 1 < argc;
+    if (arg == "--trace" && hasValue) { tracePath = args[++i]; }
+    else if (arg == "--config" && hasValue) { configDirectory = args[++i]; }
+    else if (arg == "--repeat" && hasValue) { repeat = std::max(1, atoi(args[++i])); }
+    else if (arg == "--paste-above" && hasValue) { pasteAbove = std::max(0, atoi(args[++i])); }
+    else if (arg == "--unicode-input") { unicodeInput = true; }
+    else if (arg == "--engine" && hasValue)
+    {
+      if (!parseEngine(args[++i], &engine))
+      {
+        fprintf(stderr, "Unknown engine %s\n", args[i]);
+        return 1;
+      }
+    }
+    else
+    {
+      printUsage();
+      return arg == "--help" ? 0 : 1;
+    }
+  }
+
+  if (tracePath == nullptr)
+  {
+    printUsage();
+    return 1;
+  }
+
+  // The whole trace is read up front so the replay itself never touches the disk. This also has
+  // to happen before we move into the config directory or a relative --trace would break.
+  std::vector<KeyEvent> events;
+  {
+    KeyTraceReader reader;
+    if (!reader.open(tracePath))
+    {
+      fprintf(stderr, "Can't read %s\n", tracePath);
+      return 1;
+    }
+    KeyEvent event;
+    while (reader.next(&event))
+    {
+      events.push_back(event);
+    }
+  }
+
+  if (configDirectory != nullptr)
+  {
+    std::error_code error;
+    std::filesystem::current_path(configDirectory, error);
+    if (error)
+    {
+      fprintf(stderr, "Can't use %s: %s\n", configDirectory, error.message().c_str());
+      return 1;
+    }
+  }
+
+  // Plans are made for the same layout the sink counts keystrokes on, as they would be on a desktop
+  RecordingSink sink;
+  sink.keyMap.unicode  = unicodeInput;
+  AppData *data        = new AppData();
+  data->engine         = engine;
+  data->pasteAbove     = pasteAbove;
+  data->keyMap         = std::make_shared<KeyMap>(sink.keyMap);
+  Clock::time_point t0 = Clock::now();
+  data->init();
+  Clock::time_point t1 = Clock::now();
+
+  long long expansions = 0;
+  std::vector<uint32_t> samples;
+  samples.reserve(events.size() * repeat);
+
+  Clock::time_point start = Clock::now();
+  for (int round = 0; round < repeat; round++)
+  {
+    for (size_t i = 0; i < events.size(); i++)
+    {
+      Clock::time_point before = Clock::now();
+      if (data->onKeyPress(events[i].pressed, &sink) != -1) { expansions++; }
+      Clock::duration elapsed = Clock::now() - before;
+      samples.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+  }
+  Clock::time_point end = Clock::now();
+
+  long long keystrokes = (long long)samples.size();
+  double replayNs      = std::chrono::duration<double, std::nano>(end - start).count();
+  double traceSeconds  = events.empty() ? 0.0 : events.back().time / 1e6;
+
+  std::string traceName;
+  std::string fileName = std::filesystem::path(tracePath).filename().string();
+  BulkIO::appendJsonString(traceName, fileName.data(), fileName.size());
+
+  printf("{\n");
+  printf("  \"benchmark\": \"replay\",\n");
+  printf("  \"trace\": %s,\n", traceName.c_str());
+  printf("  \"engine\": \"%s\",\n", engineName(engine));
+  printf("  \"entries\": %zu,\n", data->entries.size());
+  printf("  \"index_bytes\": %zu,\n", data->indexBytes());
+  printf("  \"load_ms\": %.3f,\n", std::chrono::duration<double, std::milli>(t1 - t0).count());
+  printf("  \"trace_seconds\": %.3f,\n", traceSeconds);
+  printf("  \"typed_keys_per_second\": %.1f,\n", traceSeconds > 0 ? events.size() / traceSeconds : 0.0);
+  printf("  \"keystrokes\": %lld,\n", keystrokes);
+  printf("  \"expansions\": %lld,\n", expansions);
+  printf("  \"characters_erased\": %lld,\n", sink.erased);
+  printf("  \"characters_typed\": %lld,\n", sink.typed);
+  printf("  \"key_strokes\": %lld,\n", sink.strokes);
+  printf("  \"planned_expansions\": %lld,\n", sink.planned);
+  printf("  \"pasted_expansions\": %lld,\n", sink.pasted);
+  printf("  \"ns_per_keystroke\": %.2f,\n", keystrokes ? replayNs / keystrokes : 0.0);
+  printf("  \"keystrokes_per_second\": %.0f,\n", replayNs > 0 ? keystrokes / (replayNs / 1e9) : 0.0);
+  printf("  \"p50_ns\": %.0f,\n", percentile(samples, 0.50));
+  printf("  \"p99_ns\": %.0f,\n", percentile(samples, 0.99));
+  printf("  \"p999_ns\": %.0f\n", percentile(samples, 0.999));
+  printf("}\n");
+
+  data->shutdown();
+  delete data;
+  return 0;
+}